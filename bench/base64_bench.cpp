@@ -0,0 +1,70 @@
+#include "../include/base64.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// decode throughput of each base64 kernel the cpu supports, on random input the size of a
+// large compressed diagram and on one the size of a typical one
+namespace helpers
+{
+    static auto random_base64(std::size_t n) -> std::string
+    {
+        constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::mt19937 random{7};
+        std::uniform_int_distribution<std::size_t> pick{0, alphabet.size() - 1};
+        std::string in(n, 'A');
+        for (auto &c : in)
+        {
+            c = alphabet[pick(random)];
+        }
+        return in;
+    }
+
+    // the best of several rounds, each decoding the input enough times to take a few milliseconds
+    static auto time_decode(std::string_view in, parser::base64::Kernel kernel) -> double
+    {
+        std::vector<unsigned char> out(parser::base64::decoded_capacity(in.size()));
+        const auto repeats = std::max<std::size_t>(1, (std::size_t{1} << 24) / in.size());
+        auto best = std::chrono::nanoseconds::max();
+        for (int round = 0; round < 5; ++round)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < repeats; ++i)
+            {
+                if (!parser::base64::decode(in, out.data(), true, kernel))
+                {
+                    std::abort();
+                }
+            }
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        const auto seconds = std::chrono::duration<double>(best).count();
+        return static_cast<double>(in.size() * repeats) / seconds / 1e6;
+    }
+}
+
+auto main() -> int
+{
+    using parser::base64::Kernel;
+    constexpr std::array kernels{std::pair{Kernel::avx2, "avx2"}, std::pair{Kernel::sse41, "sse4.1"}, std::pair{Kernel::scalar, "scalar"}};
+
+    fmt::print("{:>10} {:>10} {:>12}\n", "kernel", "input", "MB/s");
+    for (std::size_t size : {std::size_t{4} << 10, std::size_t{4} << 20})
+    {
+        const auto in = helpers::random_base64(size);
+        for (const auto &[kernel, name] : kernels)
+        {
+            if (parser::base64::supported(kernel))
+            {
+                fmt::print("{:>10} {:>9}K {:>12.0f}\n", name, size >> 10, helpers::time_decode(in, kernel));
+            }
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#ifndef BENCH_DIAGRAMS_H
+#define BENCH_DIAGRAMS_H
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// generated diagrams for the benchmarks, as the decoded <mxGraphModel> the tokenisers read,
+// laid out the way draw.io writes them
+namespace bench
+{
+    class DiagramWriter
+    {
+    public:
+        DiagramWriter() { m_xml = R"(<mxGraphModel><root><mxCell id="0"/><mxCell id="1" parent="0"/>)"; }
+
+        auto state(std::string_view id, std::string_view value) -> void
+        {
+            fmt::format_to(std::back_inserter(m_xml),
+                R"(<mxCell id="{}" value="{}" style="rounded=0;whiteSpace=wrap;html=1;" parent="1" vertex="1"><mxGeometry x="40" y="40" width="120" height="60" as="geometry"/></mxCell>)",
+                id, value);
+        }
+
+        auto decision(std::string_view id, std::string_view value) -> void
+        {
+            fmt::format_to(std::back_inserter(m_xml),
+                R"(<mxCell id="{}" value="{}" style="rhombus;whiteSpace=wrap;html=1;" parent="1" vertex="1"><mxGeometry x="40" y="40" width="80" height="80" as="geometry"/></mxCell>)",
+                id, value);
+        }
+
+        // an arrow out of a decision block is labelled with the branch it takes, 1 or 0
+        auto arrow(std::string_view source, std::string_view target, std::string_view value = {}) -> void
+        {
+            fmt::format_to(std::back_inserter(m_xml),
+                R"(<mxCell id="a{}"{}{}{} style="edgeStyle=orthogonalEdgeStyle;rounded=0;html=1;" parent="1" source="{}" target="{}" edge="1"><mxGeometry relative="1" as="geometry"/></mxCell>)",
+                m_arrows++, value.empty() ? "" : R"( value=")", value, value.empty() ? "" : R"(")", source, target);
+        }
+
+        auto finish() -> std::string
+        {
+            m_xml += "</root></mxGraphModel>";
+            return std::move(m_xml);
+        }
+
+    private:
+        std::string m_xml;
+        unsigned m_arrows = 0;
+    };
+
+    // n states, each leaving through a chain of up to two decision blocks on inputs or comparisons,
+    // every branch of which ends on a random state. About one decision block per state
+    inline auto random_machine(unsigned states, std::uint32_t seed = 1) -> std::string
+    {
+        DiagramWriter diagram;
+        std::mt19937 random{seed};
+        auto pick = [&](unsigned n) { return std::uniform_int_distribution<unsigned>{0, n - 1}(random); };
+        constexpr std::string_view comparisons[] = {"==", "!=", "&lt;", "&gt;="};
+
+        for (unsigned i = 0; i < states; ++i)
+        {
+            diagram.state(fmt::format("s{}", i), fmt::format("$STATE=S{};&lt;br&gt;$OUTPUTS={{O{},P{}}}{}", i, i % 7, i % 3, i == 0 ? ";$DEFAULT" : ""));
+        }
+        for (unsigned i = 0; i < states; ++i)
+        {
+            auto previous = fmt::format("s{}", i);
+            const auto chain = pick(3);
+            for (unsigned d = 0; d < chain; ++d)
+            {
+                auto id = fmt::format("p{}_{}", i, d);
+                diagram.decision(id, pick(2) == 0 ? fmt::format("IN{}", pick(20)) : fmt::format("X{}{}{}", pick(5), comparisons[pick(4)], pick(9)));
+                diagram.arrow(previous, id, d == 0 ? "" : "1");
+                diagram.arrow(id, fmt::format("s{}", pick(states)), "0");
+                previous = std::move(id);
+            }
+            diagram.arrow(previous, fmt::format("s{}", pick(states)), chain == 0 ? "" : "1");
+        }
+        return diagram.finish();
+    }
+
+    // one state into a chain of depth decision blocks, each false branch leading to a second
+    // state, so its case arm nests depth if-statements
+    inline auto decision_chain(unsigned depth) -> std::string
+    {
+        DiagramWriter diagram;
+        diagram.state("s0", "$STATE=A;$DEFAULT");
+        diagram.state("s1", "$STATE=B");
+        diagram.arrow("s0", "p0");
+        diagram.arrow("s1", "s0");
+        for (unsigned d = 0; d < depth; ++d)
+        {
+            const auto id = fmt::format("p{}", d);
+            diagram.decision(id, fmt::format("IN{}", d % 10));
+            diagram.arrow(id, "s1", "0");
+            diagram.arrow(id, d + 1 < depth ? fmt::format("p{}", d + 1) : std::string{"s0"}, "1");
+        }
+        return diagram.finish();
+    }
+
+    // every state feeds one ladder of depth rungs, where both branches of a rung pass through
+    // a block of their own to the next, so each state's tree doubles with every rung
+    inline auto shared_ladder(unsigned states, unsigned depth) -> std::string
+    {
+        DiagramWriter diagram;
+        for (unsigned i = 0; i < states; ++i)
+        {
+            diagram.state(fmt::format("s{}", i), fmt::format("$STATE=S{};&lt;br&gt;$OUTPUTS={{O{}}}{}", i, i % 7, i == 0 ? ";$DEFAULT" : ""));
+            diagram.arrow(fmt::format("s{}", i), "p0");
+        }
+        for (unsigned d = 0; d < depth; ++d)
+        {
+            const auto id = fmt::format("p{}", d);
+            diagram.decision(id, fmt::format("IN{}", d));
+            if (d + 1 == depth)
+            {
+                diagram.arrow(id, "s0", "1");
+                diagram.arrow(id, fmt::format("s{}", states - 1), "0");
+                continue;
+            }
+            for (auto [side, branch] : {std::pair{"a", "1"}, std::pair{"b", "0"}})
+            {
+                const auto rung = fmt::format("{}{}", side, d);
+                diagram.decision(rung, fmt::format("{}{}", side == std::string_view{"a"} ? "A" : "B", d));
+                diagram.arrow(id, rung, branch);
+                diagram.arrow(rung, fmt::format("p{}", d + 1), "1");
+            }
+        }
+        return diagram.finish();
+    }
+
+    // the best of rounds runs of f, in milliseconds
+    template <typename F>
+    auto best_ms(unsigned rounds, F &&f) -> double
+    {
+        auto best = std::chrono::steady_clock::duration::max();
+        for (unsigned round = 0; round < rounds; ++round)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+        }
+        return std::chrono::duration<double, std::milli>(best).count();
+    }
+}
+
+#endif
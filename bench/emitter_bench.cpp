@@ -0,0 +1,124 @@
+#include "diagrams.hpp"
+#include "../include/parser.hpp"
+#include "../include/transition_matrix.hpp"
+#include "../include/FSM_builder.hpp"
+#include "../include/emitter.hpp"
+#include "../include/sink.hpp"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <cstdlib>
+#include <ranges>
+
+// the emit stage on the tree shapes which used to be costly, deep chains of decision blocks,
+// shared subtrees and many states, then the emitter against writing each block into its own
+// string and re-indenting it into its parent's, as the builder once did
+namespace helpers
+{
+    // counts the module rather than keeping it
+    class CountingSink final : public utility::Sink
+    {
+    public:
+        auto write(std::string_view text) -> void override { m_bytes += text.size(); }
+
+        std::size_t m_bytes = 0;
+    };
+
+    static auto emit_ms(const std::string &xml, std::size_t &bytes) -> double
+    {
+        auto tokens = parser::stream_drawio_to_tokens(xml);
+        if (!tokens)
+        {
+            fmt::print(stderr, "{}\n", parser::error_message(tokens.error()));
+            std::exit(EXIT_FAILURE);
+        }
+        auto &[s, p, a, sy] = tokens.value();
+        const model::TransitionMatrix m(s, a, p);
+        auto map = model::build_transition_tree_map(s, p, m, sy);
+        if (!map)
+        {
+            fmt::print(stderr, "{}\n", parser::error_message(map.error()));
+            std::exit(EXIT_FAILURE);
+        }
+
+        fsm::FSMBuilder builder(map.value(), p, sy);
+        return bench::best_ms(3, [&]
+        {
+            CountingSink sink;
+            builder.write(sink);
+            bytes = sink.m_bytes;
+        });
+    }
+
+    // the old way: every block is formatted on its own, then each of its lines indented into the next
+    static auto reindent(std::string_view text) -> std::string
+    {
+        return fmt::format("  {}", fmt::join(text | std::views::split('\n') | std::views::transform([](auto line) { return std::string_view(line.begin(), line.end()); }), "\n  "));
+    }
+
+    static auto nested_strings(unsigned depth) -> std::string
+    {
+        std::string text = "next_state = B;";
+        for (unsigned d = depth; d-- > 0;)
+        {
+            text = fmt::format("if(IN{}) begin\n{}\nend else begin\n  next_state = B;\nend", d % 10, reindent(text));
+        }
+        return text;
+    }
+
+    // the same text written top down through the emitter
+    static auto nested_emitter(unsigned depth) -> std::string
+    {
+        fsm::Emitter out;
+        for (unsigned d = 0; d < depth; ++d)
+        {
+            out.write("if(IN{}) begin", d % 10);
+            out.newline();
+            out.indent();
+        }
+        out.text("next_state = B;");
+        for (unsigned d = 0; d < depth; ++d)
+        {
+            out.dedent();
+            out.newline();
+            out.text("end else begin");
+            out.newline();
+            out.indent();
+            out.text("next_state = B;");
+            out.dedent();
+            out.newline();
+            out.text("end");
+        }
+        return out.take();
+    }
+}
+
+auto main() -> int
+{
+    fmt::print("{:<34} {:>10} {:>10}\n", "emit stage", "MB out", "ms");
+    const std::pair<std::string, std::string> shapes[] = {
+        {"chain of 2000 decision blocks", bench::decision_chain(2000)},
+        {"20 states sharing 14 rungs", bench::shared_ladder(20, 14)},
+        {"100000 states", bench::random_machine(100000)},
+    };
+    for (const auto &[name, xml] : shapes)
+    {
+        std::size_t bytes = 0;
+        const auto ms = helpers::emit_ms(xml, bytes);
+        fmt::print("{:<34} {:>10.1f} {:>10.1f}\n", name, static_cast<double>(bytes) / 1e6, ms);
+    }
+
+    fmt::print("\n{:>6} {:>12} {:>12}\n", "depth", "strings ms", "emitter ms");
+    for (unsigned depth : {100u, 200u, 400u, 800u})
+    {
+        if (helpers::nested_strings(depth) != helpers::nested_emitter(depth))
+        {
+            fmt::print(stderr, "the two writers disagree at depth {}\n", depth);
+            return EXIT_FAILURE;
+        }
+        const auto strings_ms = bench::best_ms(3, [&] { static_cast<void>(helpers::nested_strings(depth)); });
+        const auto emitter_ms = bench::best_ms(3, [&] { static_cast<void>(helpers::nested_emitter(depth)); });
+        fmt::print("{:>6} {:>12.2f} {:>12.2f}\n", depth, strings_ms, emitter_ms);
+    }
+}
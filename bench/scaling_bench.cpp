@@ -0,0 +1,41 @@
+#include "diagrams.hpp"
+#include "../include/parser.hpp"
+#include "../include/transition_matrix.hpp"
+
+#include <fmt/format.h>
+
+#include <cstdlib>
+
+// how building the transition matrix and the transition trees grows with the number of elements
+// (states and decision blocks) of a diagram. With ids resolved through a hash index both should
+// stay close to linear, so the time per element should hardly move from one row to the next
+auto main() -> int
+{
+    fmt::print("{:>9} {:>12} {:>12} {:>16} {:>16}\n", "elements", "matrix ms", "trees ms", "matrix us/elem", "trees us/elem");
+    for (unsigned states : {5u, 50u, 500u, 5000u, 50000u})
+    {
+        const auto xml = bench::random_machine(states);
+        const auto tokens = parser::stream_drawio_to_tokens(xml);
+        if (!tokens)
+        {
+            fmt::print(stderr, "{}\n", parser::error_message(tokens.error()));
+            return EXIT_FAILURE;
+        }
+        const auto &[s, p, a, sy] = tokens.value();
+        const auto elements = s.size() + p.size();
+        const unsigned rounds = states < 50000 ? 5 : 2;
+
+        const auto matrix_ms = bench::best_ms(rounds, [&] { model::TransitionMatrix m(s, a, p); });
+        const model::TransitionMatrix m(s, a, p);
+        const auto trees_ms = bench::best_ms(rounds, [&]
+        {
+            if (!model::build_transition_tree_map(s, p, m, sy))
+            {
+                std::abort();
+            }
+        });
+
+        const auto per_element = 1000.0 / static_cast<double>(elements);
+        fmt::print("{:>9} {:>12.3f} {:>12.3f} {:>16.3f} {:>16.3f}\n", elements, matrix_ms, trees_ms, matrix_ms * per_element, trees_ms * per_element);
+    }
+}
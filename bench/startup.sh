@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+# Startup time of the single diagram CLI for one or more FSM.io binaries, e.g. one built
+# before and one after a dependency change:
+#
+#   bench/startup.sh build-with-curl/bin/FSM.io build/bin/FSM.io
+#
+# Each binary converts the diagram RUNS times to /dev/null. The script prints the mean wall
+# time per run for each of ROUNDS rounds, then the number of shared libraries it loads.
+# Environment: DIAGRAM (default resources/test.drawio), RUNS (default 500), ROUNDS (default 3).
+set -euo pipefail
+
+if [ "$#" -eq 0 ]; then
+    echo "usage: $0 <FSM.io binary>..." >&2
+    exit 1
+fi
+
+diagram=${DIAGRAM:-"$(dirname "$0")/../resources/test.drawio"}
+runs=${RUNS:-500}
+rounds=${ROUNDS:-3}
+
+for binary in "$@"; do
+    # one untimed run so the page cache holds the binary and its libraries
+    "$binary" -d "$diagram" > /dev/null
+
+    times=()
+    for _ in $(seq "$rounds"); do
+        start=$(date +%s%N)
+        for _ in $(seq "$runs"); do
+            "$binary" -d "$diagram" > /dev/null
+        done
+        end=$(date +%s%N)
+        times+=("$(awk -v ns="$((end - start))" -v n="$runs" 'BEGIN { printf "%.2f", ns / n / 1e6 }')")
+    done
+
+    libraries=$(ldd "$binary" | grep -c '=>' || true)
+    echo "$binary: ${times[*]} ms per run, $libraries shared libraries"
+done
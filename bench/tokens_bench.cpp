@@ -0,0 +1,33 @@
+#include "diagrams.hpp"
+#include "../include/parser.hpp"
+
+#include <fmt/format.h>
+
+#include <cstdlib>
+#include <tuple>
+
+// tokenising the decoded xml of generated diagrams through the tinyxml2 DOM (as --legacy-decode
+// does) and through the streaming cell reader, which should give the same tokens
+auto main() -> int
+{
+    fmt::print("{:>8} {:>10} {:>10} {:>10} {:>8}\n", "states", "xml KiB", "DOM ms", "stream ms", "speedup");
+    for (unsigned states : {100u, 1000u, 3000u, 10000u, 30000u})
+    {
+        const auto xml = bench::random_machine(states);
+
+        const auto dom = parser::drawio_to_tokens(xml);
+        const auto stream = parser::stream_drawio_to_tokens(xml);
+        if (!dom || !stream
+            || std::get<0>(*dom).size() != std::get<0>(*stream).size()
+            || std::get<1>(*dom).size() != std::get<1>(*stream).size()
+            || std::get<2>(*dom).size() != std::get<2>(*stream).size())
+        {
+            fmt::print(stderr, "the two tokenisers disagree on {} states\n", states);
+            return EXIT_FAILURE;
+        }
+
+        const auto dom_ms = bench::best_ms(5, [&] { static_cast<void>(parser::drawio_to_tokens(xml)); });
+        const auto stream_ms = bench::best_ms(5, [&] { static_cast<void>(parser::stream_drawio_to_tokens(xml)); });
+        fmt::print("{:>8} {:>10} {:>10.2f} {:>10.2f} {:>7.1f}x\n", states, xml.size() >> 10, dom_ms, stream_ms, dom_ms / stream_ms);
+    }
+}
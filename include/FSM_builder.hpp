@@ -4,14 +4,21 @@
 #include "FSM_elements.hpp"
 #include "tree.hpp"
 #include "observer.hpp"
-#include "utility.hpp"
+#include "emitter.hpp"
+#include "sv_template.hpp"
+#include "sink.hpp"
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <ranges>
 #include <algorithm>
 #include <numeric>
 #include <cassert>
+#include <span>
+#include <optional>
+#include <cstdint>
 #include <unordered_map>
 
 namespace fsm
@@ -23,7 +30,13 @@ namespace fsm
     class FSMBuilder
     {
     public:
-        FSMBuilder(StateTransitionMap& state_transition_map);
+        FSMBuilder(
+            StateTransitionMap& state_transition_map, 
+            const Predicates_t& predicates, 
+            const parser::SymbolTable& symbols,
+            const HouseStyle& style = HouseStyle::defaults(),
+            unsigned n_workers = 1
+        );
 
         // based on the vector of states and transition trees this builds the correctly
         // formatted output string of the corresponding systemverilog implementation
@@ -31,29 +44,100 @@ namespace fsm
         
         // writes the systemverilog string to the output, rebuilding it if
         // it has detected an update to the states or transition trees
-        auto write() -> std::string;
+        auto write() & -> std::string;
+
+        // as above, moving the string out of a builder which is done with
+        auto write() && -> std::string;
+
+        // streams the systemverilog to the sink as it is written, so the whole of it is
+        // never held at once. The text is not kept, unless it already was
+        auto write(utility::Sink& sink) -> void;
+
+        // the states and transition trees, to be changed through this so that the next write
+        // only writes the case arms of the entries which changed again
+        auto state_transition_map() -> utility::Versioned<StateTransitionMap::value_type>& 
+        { 
+            return m_state_transition_map; 
+        }
+
+        // how many case arms the last write wrote out, the others being kept from the one before
+        auto arms_written() const -> std::size_t { return m_arms_written; }
     
     private:
+        // writes the module through the templates of the house style: the header, the state
+        // enum, the state register, then the comb block with each state's case
+        auto render(Emitter& out) -> void;
+        auto write_field(Emitter& out, Template::Field field) -> void;
+
+        // what is left to write of a transition tree
+        enum class Step
+        {
+            Node,
+            Else,
+            End
+        };
+        using Steps = std::vector<std::pair<Step, TransitionTree::index_type>>;
+
+        // the case arms only read the builder once the state names are frozen, so with several
+        // workers runs of them are written at once into their own buffers, then spliced in order
+        auto write_cases(Emitter& out, const StateTransitionMap& state_transition_map) -> void;
+        auto write_arms(Emitter& out, Steps& steps, std::span<const StateTransitionMap::value_type> arms) const -> void;
+
+        // when the text is kept, so is what was written of each entry. The arms which are not
+        // kept are written on their own, at once if there are several workers, then the
+        // kept arms are spliced in order
+        auto keep_arms() -> void;
+        auto write_kept_cases(Emitter& out) -> void;
+
         // for a given state this writes it's case statement for the next state logic
         auto write_case_state(
-            std::string_view state_name,
+            Emitter& out,
+            Steps& steps,
             const parser::FSMState& state, 
             const TransitionTree& transition_tree
-        ) -> std::string;
+        ) const -> void;
 
-        // for a given transition tree this recursively forms the if-else logic which gives the next state
-        auto write_transition(const TransitionTree& transition_tree) -> std::string;
-        auto write_transition_impl(const std::unique_ptr<TransitionNode>& node) -> std::string;
+        // for a given transition tree this writes the if-else logic which gives the next
+        // state, a node at a time with an explicit stack as chains of decision blocks can be deep
+        auto write_transition(Emitter& out, Steps& steps, const TransitionTree& transition_tree) const -> void;
         
-        // if these get modified, we need to update m_fsm_string, else we know
-        // we can just output the previously computed version
-        utility::Observed<StateTransitionMap> m_state_transition_map;
+        // if any of these get modified, we need to update m_fsm_string, else we know we can
+        // just output the previously computed version. Only the arms of those modified are written again
+        utility::Versioned<StateTransitionMap::value_type> m_state_transition_map;
+
+        // the decision blocks the trees refer to, and the names of the ids, signals and states
+        const Predicates_t& m_predicates;
+        const parser::SymbolTable& m_symbols;
+        const HouseStyle& m_style;
+        unsigned m_n_workers;
 
-        // maps drawio id to s{i}
-        std::unordered_map<std::string, std::string> m_id_state_map;
+        // maps drawio id to s{i}, by symbol. An id which is not a state has no name
+        std::vector<std::string_view> m_id_state_map;
+        std::vector<std::string> m_state_names;
+        std::string m_default_state;
         
-        // the formatted systemverilog version of the FSM
+        // the formatted systemverilog version of the FSM, if it has been kept, and the
+        // version of the states and transition trees it was built from
         std::string m_fsm_string;
+        std::optional<std::uint64_t> m_built_version;
+
+        // the input signals an entry's tree tests and the text of its case arm, by the entry's
+        // version. The text prints the names of the states it names, so is dropped when any
+        // of theirs change
+        struct KeptArm
+        {
+            std::vector<parser::Symbol> m_inputs;
+            std::vector<parser::Symbol> m_named;
+            std::optional<std::string> m_text;
+        };
+        std::unordered_map<std::uint64_t, KeptArm> m_kept_arms;
+        std::vector<KeptArm*> m_arm_of; // by entry, while the text is being kept
+        std::vector<std::string> m_kept_id_state_map;
+        bool m_keeping = false;
+        std::size_t m_arms_written = 0;
+
+        // kept to reuse its storage
+        Steps m_steps;
     };
     
 }
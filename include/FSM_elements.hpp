@@ -2,26 +2,34 @@
 #define FSM_ELEMENTS_H
 
 #include "tree.hpp"
+#include "symbol_table.hpp"
 
 #include <vector>
 #include <string>
 #include <variant>
 #include <optional>
+#include <cstdint>
+#include <utility>
 
 #include "fmt/format.h"
 
 namespace parser
 {
+    using utility::Symbol;
+    using utility::SymbolTable;
+
+    // the strings of an element are interned in the diagram's SymbolTable, so elements
+    // are cheap to copy and compare
     struct FSMElement
     {
         FSMElement() = default;
         FSMElement(
-            std::string_view id)
+            Symbol id)
             : m_id{id} {}
 
         auto operator<=>(const FSMElement &) const = default;
 
-        std::string m_id;
+        Symbol m_id;
     };
 
     struct FSMState : public FSMElement
@@ -29,29 +37,29 @@ namespace parser
         FSMState() = default;
         
         FSMState(
-            std::string_view id,
-            std::string_view state_name,
-            const std::vector<std::string> &outputs,
+            Symbol id,
+            Symbol state_name,
+            std::vector<Symbol> outputs,
             const bool is_default_state
         )
             : FSMElement{id},
               m_state_name{state_name},
-              m_outputs{outputs},
+              m_outputs{std::move(outputs)},
               m_is_default_state{is_default_state} {}
         
         FSMState(
-            std::string_view id,
-            const std::vector<std::string> &outputs,
+            Symbol id,
+            std::vector<Symbol> outputs,
             const bool is_default_state
         )
             : FSMElement{id},
               m_state_name{std::nullopt},
-              m_outputs{outputs},
+              m_outputs{std::move(outputs)},
               m_is_default_state{is_default_state} {}
         
         FSMState(
-            std::string_view id,
-            std::string_view state_name,
+            Symbol id,
+            Symbol state_name,
             const bool is_default_state
         )
             : FSMElement{id},
@@ -60,7 +68,7 @@ namespace parser
               m_is_default_state{is_default_state} {}
 
         FSMState(
-            std::string_view id,
+            Symbol id,
             const bool is_default_state
         )
             : FSMElement{id},
@@ -70,8 +78,8 @@ namespace parser
 
         auto operator<=>(const FSMState &) const = default;
 
-        std::optional<std::string> m_state_name;
-        std::optional<std::vector<std::string>> m_outputs;
+        std::optional<Symbol> m_state_name;
+        std::optional<std::vector<Symbol>> m_outputs;
         bool m_is_default_state;
     };
 
@@ -79,18 +87,18 @@ namespace parser
     {
         FSMPredicate() = default;
         FSMPredicate(
-            std::string_view id,
-            std::string_view variable,
-            std::string_view comparator,
-            std::string_view comparison_value
+            Symbol id,
+            Symbol variable,
+            Symbol comparator,
+            Symbol comparison_value
         )
             : FSMElement{id},
               m_variable{variable}, 
               m_comparator{comparator}, 
               m_comparison_value{comparison_value} {}
         FSMPredicate(
-            std::string_view id,
-            std::string_view variable
+            Symbol id,
+            Symbol variable
         )
             : FSMElement{id},
               m_variable{variable}, 
@@ -99,27 +107,27 @@ namespace parser
 
         auto operator<=>(const FSMPredicate &) const = default;
 
-        auto to_string() -> std::string
+        auto to_string(const SymbolTable &symbols) const -> std::string
         {
             if (m_comparator.has_value() && m_comparison_value.has_value())
             {
-                return m_variable+m_comparator.value()+m_comparison_value.value();
+                return fmt::format("{}{}{}", symbols[m_variable], symbols[m_comparator.value()], symbols[m_comparison_value.value()]);
             }
-            return m_variable;
+            return std::string(symbols[m_variable]);
         }
 
-        std::string m_variable;
-        std::optional<std::string> m_comparator;
-        std::optional<std::string> m_comparison_value;
+        Symbol m_variable;
+        std::optional<Symbol> m_comparator;
+        std::optional<Symbol> m_comparison_value;
     };
 
     struct FSMArrow : public FSMElement
     {
         FSMArrow() = default;
         FSMArrow(
-            std::string_view id,
-            std::string_view source,
-            std::string_view target
+            Symbol id,
+            Symbol source,
+            Symbol target
         )
             : FSMElement{id},
               m_source{source},
@@ -127,9 +135,9 @@ namespace parser
               m_value{std::nullopt} {}
 
         FSMArrow(
-            std::string_view id,
-            std::string_view source,
-            std::string_view target,
+            Symbol id,
+            Symbol source,
+            Symbol target,
             const bool value
         )
             : FSMElement{id},
@@ -139,8 +147,8 @@ namespace parser
 
         auto operator<=>(const FSMArrow &) const = default;
 
-        std::string m_source;
-        std::string m_target;
+        Symbol m_source;
+        Symbol m_target;
         std::optional<bool> m_value;
     };
 
@@ -149,21 +157,22 @@ namespace parser
         FSMTransition() = default;
         // either its a state and has no predicate, only an idenitifying ID
         FSMTransition(
-            std::string_view id
+            Symbol id
         )
             : FSMElement{id},
               m_predicate{std::nullopt} {}
               
-        // or its a decision block in which case it its just a wrapper for the predicate really
+        // or its a decision block, which refers to its predicate by index into the diagram's predicates
         FSMTransition(
-            const parser::FSMPredicate& predicate
+            Symbol id,
+            const std::uint32_t predicate
         )
-            : FSMElement{predicate.m_id},
+            : FSMElement{id},
               m_predicate{predicate} {}
 
         auto operator<=>(const FSMTransition &) const = default;
 
-        std::optional<parser::FSMPredicate> m_predicate;
+        std::optional<std::uint32_t> m_predicate;
     };
 }
 
@@ -172,9 +181,11 @@ using Arrows_t = std::vector<parser::FSMArrow>;
 using Predicates_t = std::vector<parser::FSMPredicate>;
 using Connections_t = std::vector<std::vector<std::optional<bool>>>;
 
-using TokenTuple = std::tuple<States_t, Predicates_t, Arrows_t>;
-using TransitionTree = utility::binary_tree<parser::FSMTransition>;
-using TransitionNode = utility::Node<parser::FSMTransition>;
+using TokenTuple = std::tuple<States_t, Predicates_t, Arrows_t, parser::SymbolTable>;
+// the decision blocks of a diagram, each built once and shared by every state which reaches it
+using TransitionGraph = utility::flat_tree<parser::FSMTransition>;
+// the transition out of a state, rooted in its diagram's TransitionGraph
+using TransitionTree = utility::shared_subtree<parser::FSMTransition>;
 using StateTransitionMap = std::vector<std::pair<parser::FSMState, TransitionTree>>;
 
 #endif
\ No newline at end of file
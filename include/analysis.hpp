@@ -0,0 +1,46 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "FSM_elements.hpp"
+#include "transition_matrix.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace model
+{
+    // the parts of a diagram which can never take effect, found by walking its transitions
+    // from the state the module resets to
+    struct Reachability
+    {
+        std::optional<unsigned> m_reset;              // index of the reset state, none if there are no transitions
+        std::vector<unsigned> m_unreachable_states;   // indices of the states the reset state never leads to
+        std::vector<unsigned> m_dead_end_states;      // indices of the states with no transitions out
+        std::vector<unsigned> m_unreached_predicates; // indices of the decision blocks the reset state never leads to
+    };
+
+    // the index of the state FSMBuilder resets to: the last $DEFAULT state with a transition,
+    // or failing that the state of the first transition. None if there are no transitions
+    [[nodiscard]] auto reset_state(
+        const States_t& states,
+        const StateTransitionMap& state_transition_map
+    ) -> std::optional<unsigned>;
+
+    // reachability from the state FSMBuilder resets to. The walk is breadth first over
+    // packed bitsets, a level at a time
+    [[nodiscard]] auto analyse_reachability(
+        const States_t& states,
+        const Predicates_t& predicates,
+        const TransitionMatrix& transition_matrix,
+        const StateTransitionMap& state_transition_map
+    ) -> Reachability;
+
+    // drops the transitions out of unreachable states, so they are not emitted
+    auto prune_unreachable(
+        StateTransitionMap& state_transition_map,
+        const States_t& states,
+        const Reachability& reachability
+    ) -> void;
+}
+
+#endif
@@ -1,18 +1,91 @@
 #ifndef APP_H
 #define APP_H
 
+#include "parser.hpp"
+#include "cache.hpp"
+#include "sink.hpp"
+#include "sv_template.hpp"
+
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <string>
+#include <vector>
+#include <cstdint>
+
+#include <tl/expected.hpp>
 
 namespace app 
 {
+    // part of the build cache key, bump whenever the generated output changes
+    inline constexpr std::string_view version = "0.2.0";
+
     struct Options
     {
         std::optional<std::filesystem::path> out_file; 
+
+        // batch mode: where to write the <diagram stem>.sv files (defaults to beside each diagram)
+        std::optional<std::filesystem::path> out_dir;
+        // batch mode: number of worker threads (0 picks the hardware concurrency)
+        unsigned jobs = 0;
+
+        // reuse previously generated modules for unchanged diagrams (optional)
+        std::optional<std::filesystem::path> cache_dir;
+        unsigned cache_max_entries = 4096;
+
+        // decode through the separate base64 -> inflate -> url decode stages rather than
+        // the fused streaming decoder, for comparison
+        bool legacy_decode = false;
+
+        // the most nodes the if-statements of a diagram may have once written out, past
+        // which conversion fails rather than emitting an exponential number of paths
+        std::uint64_t max_decision_nodes = std::uint64_t{1} << 24;
+
+        // number of threads expanding the transition trees of each diagram (0 picks the
+        // hardware concurrency). Small diagrams are always expanded on the calling thread
+        unsigned tree_jobs = 1;
+
+        // number of threads writing the case arms of each module (0 picks the hardware
+        // concurrency). The output is the same for any number
+        unsigned emit_jobs = 1;
+
+        // list the states and decision blocks which can never take effect, and optionally
+        // leave the unreachable states out of the module. The reports need the diagram
+        // analysed, so with either set the cache is not used
+        bool report_unreachable = false;
+        bool prune_unreachable = false;
+
+        // merge the states which behave the same into one, listing the merges on stderr.
+        // As with the analysis, the cache is not used so the merges are always listed
+        bool minimise_states = false;
+
+        // the templates modules are laid out by, loaded once up front (defaults to the built in layout)
+        std::shared_ptr<const fsm::HouseStyle> house_style;
     };
 
+    // runs the whole decode -> tokenise -> transition tree -> systemverilog pipeline
+    // for one diagram, returning the module text rather than throwing on failure.
+    // With a cache, unchanged diagrams are answered without decoding them at all
+    [[nodiscard]] auto convert(
+        const std::filesystem::path& path, 
+        const Options& options,
+        cache::BuildCache* build_cache = nullptr
+    ) -> tl::expected<std::string, parser::ParseError>;
+
+    // as above, streaming the module into the sink as it is written rather than holding
+    // all of it. With a cache it is held after all, as the cache keeps whole modules
+    auto convert(
+        const std::filesystem::path& path, 
+        const Options& options,
+        utility::Sink& sink,
+        cache::BuildCache* build_cache = nullptr
+    ) -> tl::expected<void, parser::ParseError>;
+
     auto run(const std::filesystem::path& path, Options options) -> void;
+
+    // converts every diagram on a pool of workers, reporting each failure on stderr
+    // rather than aborting the batch. Returns the number of diagrams which failed
+    auto run(const std::vector<std::filesystem::path>& paths, Options options) -> unsigned;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,38 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace parser::base64
+{
+    // enough room for everything decode() writes for n characters of input
+    constexpr auto decoded_capacity(std::size_t n) -> std::size_t
+    {
+        return n / 4 * 3 + 3;
+    }
+
+    // decodes standard alphabet base64 into out, which needs decoded_capacity(in.size()) bytes,
+    // returning the number of bytes decoded or std::nullopt if the input is not valid base64.
+    // Trailing '=' padding is only accepted when allow_padding is set, so a stream can be
+    // decoded in pieces whose lengths are multiples of 4 with only the last one padded.
+    // Uses AVX2 or SSE4.1 when the cpu supports them, otherwise a table driven scalar loop
+    [[nodiscard]] auto decode(std::string_view in, unsigned char *out, bool allow_padding = true) -> std::optional<std::size_t>;
+
+    // the loops decode() can run on, so they can be checked and timed against each other
+    enum class Kernel
+    {
+        avx2,
+        sse41,
+        scalar
+    };
+
+    // whether the cpu can run the kernel, the scalar loop always can
+    [[nodiscard]] auto supported(Kernel kernel) -> bool;
+
+    // as decode() above through the given kernel, which needs to be supported
+    [[nodiscard]] auto decode(std::string_view in, unsigned char *out, bool allow_padding, Kernel kernel) -> std::optional<std::size_t>;
+}
+
+#endif
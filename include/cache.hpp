@@ -0,0 +1,60 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+
+namespace cache
+{
+    struct CacheStats
+    {
+        unsigned hits;
+        unsigned etag_hits; // the subset of hits found from the <mxfile> etag alone
+        unsigned misses;
+        unsigned evictions;
+    };
+
+    // an on-disk store of generated modules keyed by a hash of the encoded <diagram>
+    // payload, salted with anything else which changes the output (tool version, options).
+    // Safe to share between threads, and between processes using the same directory
+    class BuildCache
+    {
+    public:
+        BuildCache(
+            const std::filesystem::path& directory,
+            std::string_view salt,
+            const unsigned max_entries
+        );
+
+        // the cached module for this diagram. An etag seen before with a payload of the same size
+        // is trusted and answered without hashing the payload, otherwise the entry is found by the
+        // payload's key and only served if it was built from this payload
+        auto lookup(std::string_view etag, std::string_view payload) -> std::optional<std::string>;
+
+        auto store(std::string_view etag, std::string_view payload, std::string_view fsm) -> void;
+
+        // evicts the least recently used entries until at most max_entries remain
+        auto trim() -> void;
+
+        auto stats() const -> CacheStats;
+
+    private:
+        auto entry_path(std::uint64_t key) const -> std::filesystem::path;
+        auto etag_path(std::string_view etag) const -> std::filesystem::path;
+
+        std::filesystem::path m_directory;
+        std::string m_salt;
+        unsigned m_max_entries;
+
+        std::atomic<unsigned> m_hits{0};
+        std::atomic<unsigned> m_etag_hits{0};
+        std::atomic<unsigned> m_misses{0};
+        std::atomic<unsigned> m_evictions{0};
+    };
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef CELL_READER_H
+#define CELL_READER_H
+
+#include "parser.hpp"
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+
+#include <tl/expected.hpp>
+
+namespace parser::xml
+{
+    // the attributes of an <mxCell> the tokenisers read, entity decoded
+    struct Cell
+    {
+        std::optional<std::string_view> m_id;
+        std::optional<std::string_view> m_value;
+        std::optional<std::string_view> m_style;
+        std::optional<std::string_view> m_source;
+        std::optional<std::string_view> m_target;
+    };
+
+    // a pull parser over a decoded <mxGraphModel>, handing out the styled <mxCell> children
+    // of its <root> one at a time without building a tree of the document. Only the open
+    // elements are remembered, so memory does not grow with the number of cells
+    class CellReader
+    {
+    public:
+        explicit CellReader(std::string_view xml);
+
+        // the next styled cell, or nullopt once the document has been read. The views in
+        // the cell are valid until the following call. Malformed XML, or a document with no
+        // <root>, is an InvalidDecodedDrawioFile
+        [[nodiscard]] auto next() -> tl::expected<std::optional<Cell>, ParseError>;
+
+    private:
+        auto skip_markup() -> bool;
+        auto close_tag() -> bool;
+        auto open_tag() -> tl::expected<bool, ParseError>;
+        auto read_attributes(std::string_view attributes, bool want) -> bool;
+
+        std::string_view m_xml;
+        std::size_t m_pos = 0;
+
+        std::vector<std::string_view> m_open;  // names of the elements enclosing m_pos
+        unsigned m_documents = 0;              // top level elements seen, only the first is read
+        bool m_seen_root = false;
+        bool m_in_root = false;
+
+        Cell m_cell;
+        std::string m_id_buffer, m_value_buffer, m_style_buffer, m_source_buffer, m_target_buffer;
+    };
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include "parser.hpp"
+
+#include <string>
+#include <string_view>
+
+#include <tl/expected.hpp>
+
+namespace parser
+{
+    // decodes an encoded <diagram> payload to its mxGraphModel XML in one streaming pass,
+    // equivalent to base64_decode -> inflate -> url_decode. Base64 output is fed to zlib
+    // a chunk at a time and the inflated bytes are percent decoded in place as they arrive,
+    // so the only buffer the size of the diagram is the returned string
+    [[nodiscard]] auto decode_diagram(std::string_view encoded_str) -> tl::expected<std::string, ParseError>;
+}
+
+#endif
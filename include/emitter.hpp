@@ -0,0 +1,112 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include <string>
+#include <string_view>
+#include <iterator>
+#include <utility>
+
+#include "sink.hpp"
+
+#include <fmt/format.h>
+
+namespace fsm
+{
+    // appends text to one growing buffer, or a sink, indenting each line by the blocks it is in.
+    // A block indents from the line it is opened on, so an empty block still leaves its
+    // indentation behind, just as indenting an empty string did
+    class Emitter
+    {
+    public:
+        // keeps everything written until it is taken. Each level of a block is indented
+        // by the given whitespace
+        explicit Emitter(std::string_view indentation = default_indentation)
+            : m_unit{indentation} {}
+
+        // hands the text on to the sink whenever enough has been written, so only a
+        // fixed amount of it is held at once
+        explicit Emitter(utility::Sink& sink, std::string_view indentation = default_indentation);
+
+        static constexpr std::string_view default_indentation = "  ";
+
+        // formats into the buffer, the format string is checked at compile time.
+        // Newlines in the formatted text are indented like any other
+        template <typename... Args>
+        auto write(fmt::format_string<Args...> format, Args &&...args) -> void
+        {
+            const auto first = m_buffer.size();
+            fmt::format_to(std::back_inserter(m_buffer), format, std::forward<Args>(args)...);
+            if (!m_indentation.empty())
+            {
+                indent_newlines(first);
+            }
+            spill();
+        }
+
+        // writes text as it is, other than indenting its newlines
+        auto text(std::string_view str) -> void;
+
+        // ends the line, starting the next at the current indentation
+        auto newline() -> void;
+
+        // opens a block, indented one level more from the current line on
+        auto indent(unsigned levels = 1) -> void;
+
+        // closes the innermost block(s), from the next line on
+        auto dedent(unsigned levels = 1) -> void;
+
+        // indents the lines after this one by a further whitespace, which the text already
+        // written on this one is expected to start with. Undone by unalign
+        auto align(std::string_view whitespace) -> void { m_indentation.append(whitespace); }
+        auto unalign(std::string_view whitespace) -> void { m_indentation.resize(m_indentation.size() - whitespace.size()); }
+
+        // what the lines are currently indented by
+        auto indentation() const -> std::string_view { return m_indentation; }
+
+        // moves what another emitter wrote, aligned to this one's indentation, onto the end
+        // of this one, leaving the other empty but for its indentation
+        auto splice(Emitter& other) -> void
+        {
+            m_buffer.append(other.m_buffer);
+            other.m_buffer.clear();
+            spill();
+        }
+
+        // as above, from the text another emitter took
+        auto splice(std::string_view str) -> void
+        {
+            m_buffer.append(str);
+            spill();
+        }
+
+        auto reserve(std::size_t size) -> void { m_buffer.reserve(size); }
+
+        // the text written so far, leaving the emitter empty
+        auto take() -> std::string;
+
+        // hands whatever is still held on to the sink
+        auto flush() -> void;
+
+    private:
+        auto indent_newlines(std::size_t first) -> void;
+
+        auto spill() -> void
+        {
+            if (m_sink != nullptr && m_buffer.size() >= spill_size)
+            {
+                flush();
+            }
+        }
+
+        static constexpr std::size_t spill_size = std::size_t{1} << 16;
+
+        utility::Sink* m_sink = nullptr;
+        fmt::memory_buffer m_buffer;
+
+        // one level of a block, and what every line is currently indented by
+        std::string_view m_unit;
+        std::string m_indentation;
+    };
+}
+
+#endif
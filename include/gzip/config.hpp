@@ -1,5 +0,0 @@
-#pragma once
-
-#ifndef ZLIB_CONST
-#define ZLIB_CONST
-#endif
\ No newline at end of file
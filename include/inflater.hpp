@@ -0,0 +1,58 @@
+#ifndef INFLATER_H
+#define INFLATER_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifndef ZLIB_CONST
+#define ZLIB_CONST
+#endif
+#include <zlib.h>
+
+namespace parser
+{
+    // a raw deflate decompressor which keeps its z_stream alive between diagrams, resetting it
+    // rather than paying for inflateInit2/inflateEnd each time. It also remembers how far recent
+    // diagrams inflated, so output buffers can be sized up front instead of grown as they fill
+    class Inflater
+    {
+    public:
+        Inflater();
+        ~Inflater();
+
+        Inflater(const Inflater&) = delete;
+        auto operator=(const Inflater&) -> Inflater& = delete;
+
+        // the inflater owned by the calling thread
+        static auto local() -> Inflater&;
+
+        // readies the stream for a new diagram, false if zlib could not be initialised
+        [[nodiscard]] auto begin() -> bool;
+
+        // the stream to drive with ::inflate between begin() and finish()
+        auto stream() -> z_stream& { return m_stream; }
+
+        // records the ratio of the diagram just inflated
+        auto finish() -> void;
+
+        // inflates a whole raw deflate stream into out, false on corrupt or truncated input
+        [[nodiscard]] auto inflate(std::string_view compressed, std::string& out) -> bool;
+
+        // expected inflated size of compressed bytes, going by the recent diagrams
+        auto size_hint(std::size_t compressed) const -> std::size_t;
+
+    private:
+        static constexpr std::size_t history_size = 16;
+
+        z_stream m_stream;
+        bool m_initialised;
+
+        std::array<double, history_size> m_ratios;
+        std::size_t m_n_ratios;
+        std::size_t m_next_ratio;
+    };
+}
+
+#endif
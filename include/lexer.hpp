@@ -0,0 +1,44 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include "parser.hpp"
+
+#include <string>
+#include <string_view>
+#include <optional>
+
+#include <tl/expected.hpp>
+
+namespace parser::lexer
+{
+    // what a state's label specifies, as views into the label
+    struct StateLabel
+    {
+        std::optional<std::string_view> m_name;    // from $STATE=<name>
+        std::optional<std::string_view> m_outputs; // the comma separated list of $OUTPUTS={...} or {...}
+        bool m_is_default = false;                 // from $DEFAULT
+    };
+
+    // what a decision block's label specifies, as views into the label
+    struct PredicateLabel
+    {
+        std::string_view m_variable;
+        std::optional<std::string_view> m_comparator;
+        std::optional<std::string_view> m_comparison_value;
+    };
+
+    // removes html markup, i.e. everything from a '<' up to the next '>'. Returns the input
+    // itself when there is none, otherwise the stripped text is written to buffer
+    [[nodiscard]] auto strip_tags(std::string_view text, std::string& buffer) -> std::string_view;
+
+    // splits a stripped state label on ';' and recognises, in any order
+    //   $STATE=<name>, $OUTPUTS={<a,b,..>}, {<a,b,..>}, $DEFAULT
+    // where the first of each kind is used and any other token is ignored
+    [[nodiscard]] auto lex_state(std::string_view label) -> StateLabel;
+
+    // recognises a stripped decision block label of the form <variable> or
+    // <variable><comparator><value>, with <comparator> one of ==, !=, <=, <, >=, >
+    [[nodiscard]] auto lex_predicate(std::string_view label) -> tl::expected<PredicateLabel, ParseError>;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <filesystem>
+#include <string_view>
+#include <utility>
+
+#include <tl/expected.hpp>
+
+namespace utility
+{
+    // a read-only memory mapping of a whole file, unmapped when it goes out of scope.
+    // Moving it leaves the mapped address unchanged, so views into it stay valid
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        auto operator=(const MappedFile&) -> MappedFile& = delete;
+
+        MappedFile(MappedFile&& other) noexcept
+            : m_data{std::exchange(other.m_data, nullptr)},
+              m_size{std::exchange(other.m_size, 0)} {}
+
+        auto operator=(MappedFile&& other) noexcept -> MappedFile&
+        {
+            if (this != &other)
+            {
+                unmap();
+                m_data = std::exchange(other.m_data, nullptr);
+                m_size = std::exchange(other.m_size, 0);
+            }
+            return *this;
+        }
+
+        ~MappedFile() { unmap(); }
+
+        // fails with the errno of whichever of open/fstat/mmap went wrong
+        [[nodiscard]] static auto open(const std::filesystem::path& path) -> tl::expected<MappedFile, int>;
+
+        auto view() const -> std::string_view { return {m_data, m_size}; }
+
+    private:
+        MappedFile(const char* data, std::size_t size) 
+            : m_data{data}, m_size{size} {}
+
+        auto unmap() -> void;
+
+        const char* m_data = nullptr;
+        std::size_t m_size = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef MINIMISE_H
+#define MINIMISE_H
+
+#include "FSM_elements.hpp"
+
+#include <vector>
+
+namespace model
+{
+    // states found to behave the same, all but one of which were left out of the module
+    struct MergedStates
+    {
+        parser::FSMState m_kept;
+        std::vector<parser::FSMState> m_merged;
+    };
+
+    // merges the states which are equivalent: they set the same outputs, and test the same
+    // decision blocks in the same order to reach equivalent states. A state's arm is the
+    // first of its transitions, as the case statement takes the first matching arm.
+    // The coarsest such partition is found by Hopcroft's partition refinement, in the
+    // O(m log n) form of Valmari and Lehtinen for partial transition functions.
+    // The reset state is always kept, the others merge into the first of their class
+    auto minimise_states(
+        StateTransitionMap& state_transition_map,
+        const States_t& states,
+        const Predicates_t& predicates
+    ) -> std::vector<MergedStates>;
+}
+
+#endif
@@ -2,101 +2,76 @@
 #define OBSERVER_H
 
 #include <concepts>
-#include <numeric>
-#include <string>
-#include <algorithm>
-#include <memory>
-#include <functional>
+#include <cstdint>
 #include <utility>
+#include <vector>
 
 namespace utility
 {
+    // observes a vector entry by entry. Every write stamps what it changes with a new version
+    // from one clock, so a reader can tell which entries changed since it last looked, rather
+    // than just that something did. Versions are never reused, so an entry is recognised by
+    // its version wherever it has moved to
     template <std::movable T>
-    class Observed
+    class Versioned
     {
     public:
-        // ctors
-        Observed() 
-            : m_data{nullptr}, m_updated{false} {};
-
-        Observed(T &data) 
-            : m_data{&data}, m_updated{true} {};
-
-        Observed(T* data) 
-            : m_data{data}, m_updated{true} {};
-
-        // copy ctor
-        Observed(const Observed& other) 
-            : m_data{other.m_data},
-              m_updated{other.m_updated} {}
-
-        // move ctor
-        Observed(Observed&& other)
-            : m_data{other.m_data},
-              m_updated{std::move(other.m_updated)} {}
-
-        // copy assignment operator
-        auto operator=(const T& other) -> T &
+        // the data is taken as it is, a version for each entry
+        explicit Versioned(std::vector<T>& data)
+            : m_data{&data}
         {
-            if (this != &other)
+            m_versions.reserve(data.size());
+            for (std::size_t i = 0; i < data.size(); ++i)
             {
-                m_data    = other.m_data;
-                m_updated = other.m_updated;
+                m_versions.push_back(++m_clock);
             }
-            return *this;
         }
 
-        // move assignment operator
-        auto operator=(T &&other) -> T &
-        {
-            if (this != &other)
-            {
-                m_data    = std::exchange(other.m_data, {});
-                m_updated = std::exchange(other.m_updated, true);
-            }
-            return *this;
-        }
+        auto size() const -> std::size_t { return m_data->size(); }
+
+        auto operator[](std::size_t i) const -> const T& { return (*m_data)[i]; }
+
+        auto value() const -> const std::vector<T>& { return *m_data; }
+
+        // the version of an entry, and the latest version of anything
+        auto version(std::size_t i) const -> std::uint64_t { return m_versions[i]; }
+        auto version() const -> std::uint64_t { return m_clock; }
 
-        // setting the data leaves it 'updated'
-        //template <typename U> requires(std::same_as<T, U>)
-        auto write(const T &value) -> void
+        auto write(std::size_t i, T value) -> void
         {
-            *m_data = value;
-            m_updated = true;
+            (*m_data)[i] = std::move(value);
+            m_versions[i] = ++m_clock;
         }
 
-        // if you want to update the value via a class method of T
-        template<typename Ret, typename... Args, typename U>
-        requires(std::same_as<T, U> && !std::is_integral_v<U>)
-        auto call(Ret (U::*func)(Args...), Args... args) 
+        auto insert(std::size_t i, T value) -> void
         {
-            m_updated = true;
-            return std::invoke(func, *m_data, args...);
+            m_data->insert(m_data->begin() + static_cast<std::ptrdiff_t>(i), std::move(value));
+            m_versions.insert(m_versions.begin() + static_cast<std::ptrdiff_t>(i), ++m_clock);
         }
 
-        // to test if it has since been modified (i.e. written without reading)
-        auto modified() -> bool
+        auto erase(std::size_t i) -> void
         {
-            return m_updated;
+            m_data->erase(m_data->begin() + static_cast<std::ptrdiff_t>(i));
+            m_versions.erase(m_versions.begin() + static_cast<std::ptrdiff_t>(i));
+            ++m_clock;
         }
 
-        // reading the value means it has no longer been updated
-        auto value() -> T &
+        // replaces every entry, as when the diagram is converted again
+        auto assign(std::vector<T> values) -> void
         {
-            m_updated = false;
-            return *m_data;
+            *m_data = std::move(values);
+            m_versions.clear();
+            for (std::size_t i = 0; i < m_data->size(); ++i)
+            {
+                m_versions.push_back(++m_clock);
+            }
         }
 
     private:
-        T* m_data;
-        bool m_updated;
+        std::vector<T>* m_data;
+        std::vector<std::uint64_t> m_versions;
+        std::uint64_t m_clock = 0;
     };
-    
-    auto any_of_modified(Observed<auto>&... observers)
-    {
-        return (observers.modified() || ...);
-    }
-
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,52 @@
+#ifndef PARSE_ERROR_H
+#define PARSE_ERROR_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace parser
+{
+    // what went wrong converting a diagram, and for errors found in its structure the
+    // draw.io ids of the elements involved. A kind converts to an error without ids, so
+    // tl::unexpected(ParseError::X) works as it did for the plain enum
+    class ParseError
+    {
+    public:
+        enum class Kind
+        {
+            EmptyPath,
+            InvalidEncodedDrawioFile,
+            ExtractingDrawioString,
+            URLDecodeError,
+            Base64DecodeError,
+            InflationError,
+            DrawioToToken,
+            DecisionPathError,
+            InvalidDecodedDrawioFile,
+            MissingSourceArrow,
+            MissingTargetArrow,
+            IncorrectPredicateFormat,
+            InvalidBooleanSpecifier,
+            DecisionCycle,
+            DecisionBudgetExceeded
+        };
+        using enum Kind;
+
+        ParseError(Kind kind)
+            : m_kind{kind} {}
+
+        ParseError(Kind kind, std::vector<std::string> ids)
+            : m_kind{kind}, m_ids{std::move(ids)} {}
+
+        auto kind() const -> Kind { return m_kind; }
+
+        auto ids() const -> const std::vector<std::string> & { return m_ids; }
+
+    private:
+        Kind m_kind;
+        std::vector<std::string> m_ids;
+    };
+}
+
+#endif
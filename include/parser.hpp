@@ -2,37 +2,37 @@
 #define PARSER_H
 
 #include "FSM_elements.hpp"
+#include "parse_error.hpp"
 #include "tree.hpp"
+#include "mapped_file.hpp"
 
 #include <string_view>
 #include <optional>
 #include <variant>
 #include <ranges>
 #include <filesystem>
+#include <vector>
 
 #include <tl/expected.hpp>
 #include <tinyxml2.h>
 
 namespace parser
 {
-    enum class ParseError
+    // a memory mapped <mxfile>, with views of the parts the rest of the pipeline needs
+    struct MappedDrawio
     {
-        EmptyPath,
-        InvalidEncodedDrawioFile,
-        ExtractingDrawioString,
-        URLDecodeError,
-        Base64DecodeError,
-        InflationError,
-        DrawioToToken,
-        DecisionPathError,
-        InvalidDecodedDrawioFile,
-        MissingSourceArrow,
-        MissingTargetArrow,
-        IncorrectPredicateFormat,
-        InvalidBooleanSpecifier
+        utility::MappedFile m_file;
+        std::string_view m_etag;                // changed by draw.io on every save, empty if absent
+        std::vector<std::string_view> m_diagrams; // the encoded text of each <diagram> page
     };
 
-    void HandleParseError(const ParseError err);
+    // human readable description of a parse error, naming the elements involved if it has any
+    [[nodiscard]] auto error_message(const ParseError& err) -> std::string;
+
+    void HandleParseError(const ParseError& err);
+
+    // finds the <diagram> payloads in place without building a DOM of the file
+    [[nodiscard]] auto map_drawio_file(const std::filesystem::path &path) -> tl::expected<MappedDrawio, ParseError>;
 
     [[nodiscard]] auto extract_encoded_drawio(const std::filesystem::path &path) -> tl::expected<std::string, ParseError>;
 
@@ -43,6 +43,9 @@ namespace parser
     [[nodiscard]] auto url_decode(std::string_view encoded_str) -> tl::expected<std::string, ParseError>;
 
     [[nodiscard]] auto drawio_to_tokens(std::string_view drawio_xml_str) -> tl::expected<::TokenTuple, ParseError>;
+
+    // the same tokens as drawio_to_tokens, read in a single pass over the cells without a DOM
+    [[nodiscard]] auto stream_drawio_to_tokens(std::string_view drawio_xml_str) -> tl::expected<::TokenTuple, ParseError>;
 }
 
 #endif
\ No newline at end of file
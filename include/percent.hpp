@@ -0,0 +1,19 @@
+#ifndef PERCENT_H
+#define PERCENT_H
+
+namespace parser::percent
+{
+    struct DecodeResult
+    {
+        char *out;         // one past the last decoded byte
+        const char *rest;  // start of the input left undecoded, last when everything was
+    };
+
+    // percent decodes [first, last) into out, which may be first itself to decode in place.
+    // A '%' not followed by two hex digits is copied literally, as curl_easy_unescape does.
+    // Unless final, an escape cut short by last is left undecoded so that a stream can
+    // pick it up again once more input has arrived
+    auto decode(const char *first, const char *last, char *out, bool final = true) -> DecodeResult;
+}
+
+#endif
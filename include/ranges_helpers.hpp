@@ -45,6 +45,8 @@ namespace utility
     template<class T, class E>
     constexpr bool is_expected<tl::expected<T, E>> = true;
 
+    // the values of a range of expecteds, each moved out, or the first error. Each element
+    // is read once, so a view which builds them is only run once per element
     template<ranges::input_range R>
     requires is_expected<ranges::range_value_t<R>>
     auto to_expected(R&& r) {
@@ -53,17 +55,21 @@ namespace utility
         using error_type = expected_type::error_type;
         using return_type = tl::expected<std::vector<value_type>, error_type>;
 
-        auto values = r
-            | views::take_while([](const auto& e) { return e.has_value(); })
-            | views::transform([](const auto& e) { return e.value(); });
-
         // for simplicity, only use vector to store the result
         std::vector<value_type> v;
-        auto [it, out] = ranges::copy(values, std::back_inserter(v));
-        if (it.base() == r.end()) // all success
-            return return_type(std::move(v));
-        // return the first error
-        return return_type(tl::unexpect, (*it.base()).error());
+        if constexpr (ranges::sized_range<R>)
+        {
+            v.reserve(ranges::size(r));
+        }
+        for (auto&& e : r)
+        {
+            if (!e.has_value())
+            {
+                return return_type(tl::unexpect, std::move(e).error());
+            }
+            v.push_back(std::move(e).value());
+        }
+        return return_type(std::move(v));
     };
 }
 
@@ -0,0 +1,59 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace utility
+{
+    // somewhere for generated text to go, handed over a piece at a time
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+
+        virtual auto write(std::string_view text) -> void = 0;
+    };
+
+    // collects the text in memory
+    class StringSink final : public Sink
+    {
+    public:
+        auto write(std::string_view text) -> void override { m_text.append(text); }
+
+        auto take() -> std::string { return std::exchange(m_text, {}); }
+
+    private:
+        std::string m_text;
+    };
+
+    // writes to a file, or to stdout without a path. The file is only created by the first
+    // write, so a conversion which fails before then leaves any previous output in place
+    class FileSink final : public Sink
+    {
+    public:
+        explicit FileSink(std::optional<std::filesystem::path> path = std::nullopt)
+            : m_path{std::move(path)} {}
+
+        FileSink(const FileSink&) = delete;
+        auto operator=(const FileSink&) -> FileSink& = delete;
+
+        ~FileSink() override { static_cast<void>(close()); }
+
+        auto write(std::string_view text) -> void override;
+
+        // flushes what is buffered and closes the file, false if any of it could not be written
+        [[nodiscard]] auto close() -> bool;
+
+    private:
+        std::optional<std::filesystem::path> m_path;
+        std::FILE* m_file = nullptr;
+        bool m_failed = false;
+    };
+}
+
+#endif
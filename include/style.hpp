@@ -0,0 +1,34 @@
+#ifndef STYLE_H
+#define STYLE_H
+
+#include <string_view>
+
+namespace parser::style
+{
+    // the shapes and edges a style names which the tokenisers tell apart
+    enum Kind : unsigned
+    {
+        Text           = 1 << 0, // text
+        Rhombus        = 1 << 1, // rhombus, a decision block
+        OrthogonalEdge = 1 << 2, // edgeStyle=orthogonalEdgeStyle, a transition arrow
+    };
+
+    // the kinds a cell's "style" attribute names, found in one pass over it
+    struct Style
+    {
+        [[nodiscard]] auto is(Kind kind) const -> bool
+        {
+            return (m_kinds & kind) != 0;
+        }
+
+        unsigned m_kinds = 0;
+    };
+
+    // splits a style on ';' into bare tokens and key=value pairs, noting the kinds they name
+    [[nodiscard]] auto parse(std::string_view style) -> Style;
+
+    // as above, into an existing Style
+    auto parse(std::string_view style, Style &result) -> void;
+}
+
+#endif
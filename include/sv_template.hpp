@@ -0,0 +1,110 @@
+#ifndef SV_TEMPLATE_H
+#define SV_TEMPLATE_H
+
+#include "emitter.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <tl/expected.hpp>
+
+namespace fsm
+{
+    // a systemverilog template, parsed once into a plan of the literal text to write and
+    // the {field}s to write between it. Braces around anything but a field name are left
+    // as they are, so the braces of an enum need no escaping
+    class Template
+    {
+    public:
+        enum class Field : std::uint8_t
+        {
+            // the port declarations
+            Inputs,
+            Outputs,
+
+            // the other templates, which only the module template may place
+            StateDecl,
+            StateReg,
+            NextState,
+
+            StateNames,
+            ResetState,
+            DefaultState,
+            OutputsDefaults,
+            Cases
+        };
+
+        // fails naming the first placeholder which is not a field, or which places a
+        // template outside of the module template
+        [[nodiscard]] static auto parse(std::string_view text, bool is_module) -> tl::expected<Template, std::string>;
+
+        // writes the literal text, calling write_field for each field in between. The lines
+        // a field writes after its first are indented as far as the line it is placed on
+        template <typename WriteField>
+        auto render(Emitter& out, WriteField&& write_field) const -> void
+        {
+            for (const auto& step : m_plan)
+            {
+                out.text(slice(step.m_text));
+                if (step.m_field.has_value())
+                {
+                    const auto indentation = slice(step.m_indentation);
+                    out.align(indentation);
+                    write_field(step.m_field.value());
+                    out.unalign(indentation);
+                }
+            }
+        }
+
+        auto source() const -> std::string_view { return m_source; }
+
+    private:
+        // a part of the source
+        struct Span
+        {
+            std::uint32_t m_offset = 0;
+            std::uint32_t m_size = 0;
+        };
+
+        // literal text, then the field after it (the last step has none)
+        struct Step
+        {
+            Span m_text;
+            std::optional<Field> m_field;
+            Span m_indentation;
+        };
+
+        auto slice(Span span) const -> std::string_view
+        {
+            return std::string_view(m_source).substr(span.m_offset, span.m_size);
+        }
+
+        std::string m_source;
+        std::vector<Step> m_plan;
+    };
+
+    // the templates a module is laid out by
+    struct HouseStyle
+    {
+        Template m_module;   // FSM_template.sv
+        Template m_states;   // state_template.sv
+        Template m_register; // state_register_template.sv
+        Template m_comb;     // nest_state_template.sv
+
+        // one level of indentation in the case arms, the same as the comb template's first
+        std::string m_indentation;
+
+        // the layout FSM.io has always written, built in and parsed on first use
+        static auto defaults() -> const HouseStyle&;
+
+        // reads the four templates from a directory such as resources/fsm. Their final
+        // newline is not part of them, so files can end as editors like
+        [[nodiscard]] static auto load(const std::filesystem::path& directory) -> tl::expected<HouseStyle, std::string>;
+    };
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace utility
+{
+    // a handle to a string interned in a SymbolTable, copied and compared as an integer
+    enum class Symbol : std::uint32_t {};
+
+    // the ids, names and signals of one diagram, each stored once. Symbols are handed out
+    // densely from 0 in the order strings are first seen. The characters live in blocks
+    // which are never reallocated, so views of them stay valid as the table grows or moves
+    class SymbolTable
+    {
+    public:
+        SymbolTable() = default;
+        SymbolTable(const SymbolTable&) = delete;
+        auto operator=(const SymbolTable&) -> SymbolTable& = delete;
+        SymbolTable(SymbolTable&&) = default;
+        auto operator=(SymbolTable&&) -> SymbolTable& = default;
+
+        // the symbol of str, adding it if it has not been seen before
+        auto intern(std::string_view str) -> Symbol;
+
+        auto operator[](Symbol symbol) const -> std::string_view
+        {
+            return m_strings[static_cast<std::uint32_t>(symbol)];
+        }
+
+        auto size() const -> std::size_t
+        {
+            return m_strings.size();
+        }
+
+    private:
+        auto store(std::string_view str) -> std::string_view;
+        auto rehash(std::size_t n_slots) -> void;
+
+        // open addressed, keeping part of the hash so most probes never touch the string
+        struct Slot
+        {
+            std::uint32_t m_symbol; // symbol + 1, or 0 when empty
+            std::uint32_t m_hash;
+        };
+
+        std::vector<std::string_view> m_strings; // by symbol
+        std::vector<std::size_t> m_hashes;       // by symbol, so growing never rehashes a string
+        std::vector<Slot> m_slots;
+
+        std::vector<std::unique_ptr<char[]>> m_blocks;
+        char *m_block_next = nullptr;
+        std::size_t m_block_free = 0;
+    };
+}
+
+#endif
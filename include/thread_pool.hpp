@@ -0,0 +1,152 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <optional>
+#include <algorithm>
+
+namespace utility
+{
+    // a fixed size pool of workers, each with its own task queue. Workers pop from the
+    // back of their own queue and, once it runs dry, steal from the front of the others
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(unsigned n_workers = std::thread::hardware_concurrency())
+            : m_queues(std::max(n_workers, 1u))
+        {
+            m_workers.reserve(m_queues.size());
+            for (unsigned i = 0; i < m_queues.size(); ++i)
+            {
+                m_workers.emplace_back([this, i]{ work(i); });
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard lock{m_mutex};
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        auto size() const -> unsigned
+        {
+            return static_cast<unsigned>(m_queues.size());
+        }
+
+        // tasks are dealt round-robin, stealing evens out any imbalance
+        auto submit(Task task) -> void
+        {
+            auto& queue = m_queues[m_next++ % m_queues.size()];
+            {
+                std::lock_guard lock{m_mutex};
+                {
+                    std::lock_guard queue_lock{queue.m_mutex};
+                    queue.m_tasks.push_back(std::move(task));
+                }
+                ++m_queued;
+                ++m_pending;
+            }
+            m_wake.notify_one();
+        }
+
+        // blocks until every submitted task has finished
+        auto wait() -> void
+        {
+            std::unique_lock lock{m_mutex};
+            m_done.wait(lock, [this]{ return m_pending == 0; });
+        }
+
+    private:
+        struct Queue
+        {
+            std::mutex m_mutex;
+            std::deque<Task> m_tasks;
+        };
+
+        auto pop(unsigned self) -> std::optional<Task>
+        {
+            {
+                auto& own = m_queues[self];
+                std::lock_guard lock{own.m_mutex};
+                if (!own.m_tasks.empty())
+                {
+                    auto task = std::move(own.m_tasks.back());
+                    own.m_tasks.pop_back();
+                    return task;
+                }
+            }
+            for (std::size_t i = 1; i < m_queues.size(); ++i)
+            {
+                auto& victim = m_queues[(self + i) % m_queues.size()];
+                std::lock_guard lock{victim.m_mutex};
+                if (!victim.m_tasks.empty())
+                {
+                    auto task = std::move(victim.m_tasks.front());
+                    victim.m_tasks.pop_front();
+                    return task;
+                }
+            }
+            return std::nullopt;
+        }
+
+        auto work(unsigned self) -> void
+        {
+            while (true)
+            {
+                if (auto task = pop(self); task.has_value())
+                {
+                    {
+                        std::lock_guard lock{m_mutex};
+                        --m_queued;
+                    }
+                    (*task)();
+                    std::lock_guard lock{m_mutex};
+                    if (--m_pending == 0)
+                    {
+                        m_done.notify_all();
+                    }
+                    continue;
+                }
+
+                // nothing to run or steal, sleep until there is
+                std::unique_lock lock{m_mutex};
+                m_wake.wait(lock, [this]{ return m_stop || m_queued > 0; });
+                if (m_stop && m_queued == 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        std::vector<Queue> m_queues;
+        std::vector<std::thread> m_workers;
+        std::atomic<std::size_t> m_next{0};
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        std::size_t m_queued{0};  // submitted but not yet picked up
+        std::size_t m_pending{0}; // submitted but not yet finished
+        bool m_stop{false};
+    };
+}
+
+#endif
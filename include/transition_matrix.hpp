@@ -2,22 +2,34 @@
 #define TRANSITION_MATRIX_H
 
 #include "FSM_elements.hpp"
+#include "parse_error.hpp"
 
 #include <string_view>
 #include <optional>
 #include <algorithm>
 #include <ranges>
 #include <vector>
-#include <unordered_map>
+#include <span>
+#include <cstdint>
 
+#include <tl/expected.hpp>
 #include "fmt/format.h"
 
 namespace model
 {
+    // the transitions between states and decision blocks, stored sparsely as the outgoing
+    // edges of each element (compressed sparse rows, indexed by source). Element i is
+    // states[i] for i < states.size(), and predicates[i - states.size()] after that.
+    // Queries are by (row, col) = (target, source), as for the dense matrix this replaced
     class TransitionMatrix
     {
     public:
-        using Connections_t = std::vector<std::vector<std::optional<bool>>>;
+        // an outgoing edge, taken when the source evaluates to m_value (always true for states)
+        struct Edge
+        {
+            unsigned m_target;
+            bool m_value;
+        };
 
         TransitionMatrix();
         TransitionMatrix(
@@ -26,12 +38,14 @@ namespace model
             const Predicates_t &predicates
         );
 
-        auto operator()(unsigned row, unsigned col) -> std::optional<bool> &;
         auto operator()(unsigned row, unsigned col) const -> std::optional<bool>;
 
         auto rank() -> unsigned;
         auto rank() const -> unsigned;
 
+        // the edges leaving col, in order of target
+        auto successors(unsigned col) const -> std::span<const Edge>;
+
         auto print() -> void;
         auto print() const -> void;
 
@@ -44,16 +58,28 @@ namespace model
             const Predicates_t& predicates
         ) -> void;
 
-        Connections_t m_connections;
-        const unsigned m_rank;
+        unsigned m_rank;
+        std::vector<unsigned> m_offsets; // the edges of col are m_edges[m_offsets[col], m_offsets[col+1])
+        std::vector<Edge> m_edges;
     };
 
+    // the most nodes the transition trees of a diagram may have once every path through its
+    // decision blocks is written out, as each one is emitted
+    inline constexpr std::uint64_t default_node_budget = std::uint64_t{1} << 24;
+
+    // the transition tree of each transition out of a state, in one graph which shares the
+    // decision blocks between them. Fails on a loop of decision blocks, or if writing the
+    // trees out would take more than node_budget nodes. With several workers, runs of
+    // transitions are expanded at once into a graph each, with the same trees and errors
     [[nodiscard]] 
     auto build_transition_tree_map(
         const States_t& states,
         const Predicates_t& predicates,
-        const TransitionMatrix& transition_matrix
-    ) -> StateTransitionMap;
+        const TransitionMatrix& transition_matrix,
+        const parser::SymbolTable& symbols,
+        const std::uint64_t node_budget = default_node_budget,
+        const unsigned n_workers = 1
+    ) -> tl::expected<StateTransitionMap, parser::ParseError>;
 }
 
 #endif
\ No newline at end of file
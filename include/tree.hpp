@@ -1,44 +1,91 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include <vector>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <utility>
 
 namespace utility
 {
+    // a binary tree whose nodes are stored contiguously and refer to their children by index,
+    // so building one is a push_back per node and walking it never leaves the one vector.
+    // Nodes may share children, which makes it a DAG, every path from a node is still a tree
     template <typename T>
-    struct Node
+    class flat_tree
     {
-        Node() : m_value{}, m_left{nullptr}, m_right{nullptr} {}
-        Node(const T &value) : m_value{value}, m_left{nullptr}, m_right{nullptr} {}
+    public:
+        using index_type = std::uint32_t;
+        static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+        struct FlatNode
+        {
+            T m_value;
+            index_type m_left = npos;
+            index_type m_right = npos;
+        };
+
+        flat_tree() = default;
+
+        flat_tree(const T &root)
+            : m_nodes{FlatNode{root}} {}
+
+        auto empty() const -> bool { return m_nodes.empty(); }
+
+        auto size() const -> std::size_t { return m_nodes.size(); }
+
+        auto root() const -> index_type { return empty() ? npos : 0; }
+
+        auto clear() -> void { m_nodes.clear(); }
 
-        T m_value;
-        std::unique_ptr<Node<T>> m_left;
-        std::unique_ptr<Node<T>> m_right;
+        // adds an unlinked node, which is then made a child by setting its parent's index.
+        // References to nodes do not survive an insert, their indices do
+        auto insert(const T &value) -> index_type
+        {
+            m_nodes.push_back(FlatNode{value});
+            return static_cast<index_type>(m_nodes.size() - 1);
+        }
+
+        auto operator[](index_type index) -> FlatNode & { return m_nodes[index]; }
+        auto operator[](index_type index) const -> const FlatNode & { return m_nodes[index]; }
+
+    private:
+        std::vector<FlatNode> m_nodes;
     };
 
+    // the tree below one node of a flat_tree which is shared with, and kept alive by, the
+    // subtrees of its other nodes
     template <typename T>
-    class binary_tree
+    class shared_subtree
     {
     public:
-        binary_tree()
-            : m_root{nullptr} {};
+        using index_type = typename flat_tree<T>::index_type;
+        using FlatNode = typename flat_tree<T>::FlatNode;
+        static constexpr index_type npos = flat_tree<T>::npos;
 
-        binary_tree(const T &value)
-            : m_root{std::make_unique<Node<T>>(value)} {};
+        shared_subtree() = default;
 
-        binary_tree(std::unique_ptr<Node<T>> &&value)
-            : m_root{std::move(value)} {};
+        shared_subtree(std::shared_ptr<const flat_tree<T>> nodes, index_type root)
+            : m_nodes{std::move(nodes)}, m_root{root} {}
 
-        auto empty() -> bool { return m_root == nullptr; }
+        auto empty() const -> bool { return m_root == npos; }
 
-        auto insert(std::unique_ptr<Node<T>> &node, const T &value) -> void
-        {
-            node = std::make_unique<Node<T>>(value);
-        }
+        auto root() const -> index_type { return m_root; }
+
+        // the number of nodes shared between the subtrees, every index is below it
+        auto shared_size() const -> std::size_t { return m_nodes ? m_nodes->size() : 0; }
+
+        auto operator[](index_type index) const -> const FlatNode & { return (*m_nodes)[index]; }
+
+        // the graph shared with the other subtrees
+        auto nodes() const -> const std::shared_ptr<const flat_tree<T>> & { return m_nodes; }
 
-        std::unique_ptr<Node<T>> m_root;
+    private:
+        std::shared_ptr<const flat_tree<T>> m_nodes;
+        index_type m_root = npos;
     };
 
 }
 
-#endif
\ No newline at end of file
+#endif
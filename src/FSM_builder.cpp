@@ -1,265 +1,579 @@
 #include "../include/FSM_builder.hpp"
-#include "../include/ranges_helpers.hpp"
 
-#include <ranges>
-#include <unordered_map>
+#include "../include/thread_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <span>
 
 #include <fmt/format.h>
-#include <fmt/ranges.h>
 
 
 namespace fsm 
 {
-    using namespace ::utility;
-
     FSMBuilder::FSMBuilder(
-        StateTransitionMap& state_transition_map
+        StateTransitionMap& state_transition_map,
+        const Predicates_t& predicates,
+        const parser::SymbolTable& symbols,
+        const HouseStyle& style,
+        unsigned n_workers
     )
-        : m_state_transition_map{state_transition_map}
+        : m_state_transition_map{state_transition_map},
+          m_predicates{predicates},
+          m_symbols{symbols},
+          m_style{style},
+          m_n_workers{n_workers}
     {
-        build();
-    }
-    
-    static
-    auto indent(std::string_view multi_line_str, unsigned indent_level) -> std::string
-    {        
-        std::string indent(indent_level * 2, ' ');
-        return fmt::format(
-            "{}{}",
-            indent,
-            fmt::join(
-                multi_line_str 
-                    | views::split('\n')
-                    | views::transform([](auto r) { 
-                        return std::string_view(r.begin(), r.end()); 
-                    }),
-                "\n"+indent
-            )
-        );
     }
 
-    static
-    auto input_signals_impl(
-        const std::unique_ptr<TransitionNode>& node,
-        std::vector<std::string>& predicates
-    ) -> void
+    namespace helpers
     {
-        if (node != nullptr)
+        // writes the non-empty strings given to it separated by a delimiter
+        class JoinNonEmpty
         {
-            if(node->m_value.m_predicate.has_value())
+        public:
+            JoinNonEmpty(Emitter& out, std::string_view delim)
+                : m_out{out}, m_delim{delim} {}
+
+            auto operator()(std::string_view str) -> void
             {
-                predicates.push_back(node->m_value.m_predicate.value().m_variable);
+                if (str.empty())
+                {
+                    return;
+                }
+                if (!m_first)
+                {
+                    m_out.text(m_delim);
+                }
+                m_out.text(str);
+                m_first = false;
             }
-            input_signals_impl(node->m_left, predicates);
-            input_signals_impl(node->m_right, predicates);
-        }
-        else 
+
+        private:
+            Emitter& m_out;
+            std::string_view m_delim;
+            bool m_first = true;
+        };
+
+        // every node on every path through the tree, in pre-order
+        static auto for_each_node(
+            const TransitionTree& tree,
+            std::vector<TransitionTree::index_type>& pending,
+            auto&& visit
+        ) -> void
         {
-            return;
+            if (!tree.empty())
+            {
+                pending.push_back(tree.root());
+            }
+            while (!pending.empty())
+            {
+                const auto& node = tree[pending.back()];
+                pending.pop_back();
+                visit(node);
+
+                // the left is visited first, so pushed last
+                for (auto child : {node.m_right, node.m_left})
+                {
+                    if (child != TransitionTree::npos)
+                    {
+                        pending.push_back(child);
+                    }
+                }
+            }
         }
     }
 
-    static
-    auto input_signals(const TransitionTree& tree) -> std::vector<std::string>
+    auto FSMBuilder::write() & -> std::string
     {
-        std::vector<std::string> predicates;
-        auto& root = tree.m_root;
-        input_signals_impl(root, predicates);
-        return predicates;
-    }
+        m_arms_written = 0;
 
-    auto FSMBuilder::write() -> std::string
-    {
         // use the cached string if the states and transition trees have not been modified
-        if (any_of_modified(m_state_transition_map))
+        if (m_built_version != m_state_transition_map.version())
         {
             build();
         } 
         return m_fsm_string;
     }
 
-    auto FSMBuilder::build() -> void
+    auto FSMBuilder::write() && -> std::string
+    {
+        m_arms_written = 0;
+        if (m_built_version != m_state_transition_map.version())
+        {
+            build();
+        } 
+        m_built_version.reset();
+        return std::move(m_fsm_string);
+    }
+
+    auto FSMBuilder::write(utility::Sink& sink) -> void
     {
-        // generate the (drawio id) -> (state name) mapping
-        std::vector<std::string> state_variables;
-        std::string default_state;
-        unsigned count = 0;
-        for (const auto& [state, tree] : m_state_transition_map.value())
+        m_arms_written = 0;
+        if (m_built_version == m_state_transition_map.version())
         {
-            std::string state_name = state.m_state_name.value_or(fmt::format("s{}", count));
-            state_variables.push_back(state_name);
-            m_id_state_map[state.m_id] = state_name;
+            sink.write(m_fsm_string);
+            return;
+        }
 
+        // the text kept is out of date, the arms kept are not
+        m_built_version.reset();
+        m_fsm_string = {};
+
+        Emitter out{sink, m_style.m_indentation};
+        render(out);
+        out.flush();
+    }
+
+    auto FSMBuilder::build() -> void
+    {
+        // the whole module is written into one buffer, about as large as it was last time
+        Emitter out{m_style.m_indentation};
+        out.reserve(m_fsm_string.size());
+        m_keeping = true;
+        render(out);
+        m_keeping = false;
+        m_fsm_string = out.take();
+        m_built_version = m_state_transition_map.version();
+    }
+
+    auto FSMBuilder::render(Emitter& out) -> void
+    {
+        // generate the (drawio id) -> (state name) mapping, which is not changed again
+        // until the next render
+        const auto& state_transition_map = m_state_transition_map.value();
+        m_state_names.clear();
+        m_default_state.clear();
+        for (const auto& [state, tree] : state_transition_map)
+        {
+            m_state_names.push_back(state.m_state_name.has_value() 
+                ? std::string(m_symbols[state.m_state_name.value()]) 
+                : fmt::format("s{}", m_state_names.size()));
             if (state.m_is_default_state)
             {
-                default_state = state_name;
+                m_default_state = m_state_names.back();
             }
-            count++;
+        }
+        m_id_state_map.assign(m_symbols.size(), {});
+        for (std::size_t i = 0; i < state_transition_map.size(); ++i)
+        {
+            m_id_state_map[static_cast<std::size_t>(state_transition_map[i].first.m_id)] = m_state_names[i];
         }
 
         // if no default state is specified, assign a best guess
-        if (default_state.empty() && !m_state_transition_map.value().empty())
+        if (m_default_state.empty() && !state_transition_map.empty())
         {
-            default_state = m_id_state_map[m_state_transition_map.value().front().first.m_id];
+            m_default_state = m_id_state_map[static_cast<std::size_t>(state_transition_map.front().first.m_id)];
         } 
 
-        auto case_states = m_state_transition_map.value()
-            | views::transform([this](auto&& p){ 
-                return write_case_state(m_id_state_map[p.first.m_id], p.first, p.second);
+        if (m_keeping)
+        {
+            keep_arms();
+        }
+        m_style.m_module.render(out, [&](Template::Field field){ write_field(out, field); });
+        m_arm_of.clear();
+    }
+
+    auto FSMBuilder::keep_arms() -> void
+    {
+        // the ids whose names are not those the kept arms were written with
+        std::vector<bool> renamed(m_id_state_map.size());
+        m_kept_id_state_map.resize(m_id_state_map.size());
+        for (std::size_t id = 0; id < m_id_state_map.size(); ++id)
+        {
+            if (m_kept_id_state_map[id] != m_id_state_map[id])
+            {
+                renamed[id] = true;
+                m_kept_id_state_map[id] = m_id_state_map[id];
+            }
+        }
+
+        // an entry is recognised by its version wherever it now is, anything else kept is dropped
+        const auto& state_transition_map = m_state_transition_map.value();
+        std::unordered_map<std::uint64_t, KeptArm> kept_arms;
+        kept_arms.reserve(state_transition_map.size());
+        m_arm_of.clear();
+        std::vector<TransitionTree::index_type> pending;
+        for (std::size_t i = 0; i < state_transition_map.size(); ++i)
+        {
+            const auto version = m_state_transition_map.version(i);
+            if (auto kept = m_kept_arms.extract(version); !kept.empty())
+            {
+                auto& arm = kept_arms.insert(std::move(kept)).position->second;
+                if (ranges::any_of(arm.m_named, [&](parser::Symbol id){ return renamed[static_cast<std::size_t>(id)]; }))
+                {
+                    arm.m_text.reset();
+                }
+                m_arm_of.push_back(&arm);
+                continue;
+            }
+
+            const auto& [state, tree] = state_transition_map[i];
+            auto& arm = kept_arms[version];
+            arm.m_named.push_back(state.m_id);
+            helpers::for_each_node(tree, pending, [&](const auto& node)
+            {
+                if (node.m_value.m_predicate.has_value())
+                {
+                    arm.m_inputs.push_back(m_predicates[node.m_value.m_predicate.value()].m_variable);
+                }
+                else if (node.m_left == TransitionTree::npos && node.m_right == TransitionTree::npos)
+                {
+                    arm.m_named.push_back(node.m_value.m_id);
+                }
             });
+            ranges::sort(arm.m_named);
+            arm.m_named.erase(ranges::unique(arm.m_named).begin(), arm.m_named.end());
+            m_arm_of.push_back(&arm);
+        }
+        m_kept_arms = std::move(kept_arms);
+    }
 
-        auto outputs = m_state_transition_map.value()
-            | views::transform([](auto&& p){ return p.first.m_outputs.value_or(std::vector<std::string>()); })
-            | views::join;
-
-        auto inputs = m_state_transition_map.value()
-            | views::transform([](auto&& p){ return input_signals(p.second); })
-            | views::join;
-
-        // write the header
-        auto header = fmt::format(
-            "module fsm (\n"
-            "  input logic clk, reset,\n"
-            "  input logic {},\n"
-            "  output logic {}\n"
-            ");",
-            join_non_empty_strings(inputs, ", "),
-            join_non_empty_strings(outputs, ", ")
-        );
+    auto FSMBuilder::write_kept_cases(Emitter& out) -> void
+    {
+        const auto& state_transition_map = m_state_transition_map.value();
+        std::vector<std::size_t> unkept;
+        for (std::size_t i = 0; i < m_arm_of.size(); ++i)
+        {
+            if (!m_arm_of[i]->m_text.has_value())
+            {
+                unkept.push_back(i);
+            }
+        }
+        m_arms_written += unkept.size();
+
+        // each arm is taken from its own emitter, aligned as the case statement is
+        const auto indentation = std::string(out.indentation());
+        auto write_unkept = [&](Steps& steps, std::span<const std::size_t> run)
+        {
+            Emitter arm_out{m_style.m_indentation};
+            for (auto i : run)
+            {
+                arm_out.align(indentation);
+                write_case_state(arm_out, steps, state_transition_map[i].first, state_transition_map[i].second);
+                m_arm_of[i]->m_text = arm_out.take();
+            }
+        };
+        if (m_n_workers <= 1 || unkept.size() <= 1)
+        {
+            write_unkept(m_steps, unkept);
+        }
+        else
+        {
+            const auto n_runs = std::min<std::size_t>(4 * m_n_workers, unkept.size());
+            std::vector<Steps> steps(n_runs);
+            utility::ThreadPool pool{static_cast<unsigned>(std::min<std::size_t>(m_n_workers, n_runs))};
+            for (std::size_t r = 0; r < n_runs; ++r)
+            {
+                const auto first = unkept.size() * r / n_runs;
+                const auto last = unkept.size() * (r + 1) / n_runs;
+                pool.submit([&, r, first, last]
+                {
+                    write_unkept(steps[r], std::span<const std::size_t>(unkept).subspan(first, last - first));
+                });
+            }
+            pool.wait();
+        }
+
+        for (std::size_t i = 0; i < m_arm_of.size(); ++i)
+        {
+            if (i != 0)
+            {
+                out.newline();
+            }
+            out.splice(m_arm_of[i]->m_text.value());
+        }
+    }
+
+    auto FSMBuilder::write_field(Emitter& out, Template::Field field) -> void
+    {
+        using Field = Template::Field;
+
+        const auto& state_transition_map = m_state_transition_map.value();
+        auto outputs_of = [](const parser::FSMState& state)
+        {
+            return state.m_outputs.has_value() ? std::span<const parser::Symbol>(state.m_outputs.value()) : std::span<const parser::Symbol>{};
+        };
+        auto write_section = [&](const Template& section)
+        {
+            section.render(out, [&](Field f){ write_field(out, f); });
+        };
+
+        switch (field)
+        {
+        // the header
+        case Field::Inputs:
+        {
+            out.text("input logic ");
+            helpers::JoinNonEmpty inputs(out, ", ");
+            if (m_keeping)
+            {
+                for (const auto* arm : m_arm_of)
+                {
+                    for (auto s : arm->m_inputs)
+                    {
+                        inputs(m_symbols[s]);
+                    }
+                }
+                break;
+            }
+            std::vector<TransitionTree::index_type> pending;
+            for (const auto& [state, tree] : state_transition_map)
+            {
+                helpers::for_each_node(tree, pending, [&](const auto& node)
+                {
+                    // the variables of the decision blocks
+                    if (node.m_value.m_predicate.has_value())
+                    {
+                        inputs(m_symbols[m_predicates[node.m_value.m_predicate.value()].m_variable]);
+                    }
+                });
+            }
+            break;
+        }
+        case Field::Outputs:
+        {
+            out.text("output logic ");
+            helpers::JoinNonEmpty outputs(out, ", ");
+            for (const auto& [state, tree] : state_transition_map)
+            {
+                for (auto s : outputs_of(state))
+                {
+                    outputs(m_symbols[s]);
+                }
+            }
+            break;
+        }
 
         // for the declaration of states
-        auto states_declaration = fmt::format(
-            "typedef enum {{\n"
-            "  {}\n"
-            "}} state_t;\n\n"
-            "state_t present_state, next_state;",
-            join_non_empty_strings(state_variables, ", ")
-        );
+        case Field::StateDecl:
+            write_section(m_style.m_states);
+            break;
+        case Field::StateNames:
+        {
+            helpers::JoinNonEmpty states(out, ", ");
+            for (const auto& state_name : m_state_names)
+            {
+                states(state_name);
+            }
+            break;
+        }
 
         // the synchronous register of current state
-        auto state_register = fmt::format(
-            "always_ff @( posedge clk ) begin : sync\n"
-            "  if (reset)\n"
-            "    present_state <= {};\n"
-            "  else\n"
-            "    present_state <= next_state;\n"
-            "end",
-            default_state
-        );
+        case Field::StateReg:
+            write_section(m_style.m_register);
+            break;
+        case Field::ResetState:
+        case Field::DefaultState:
+            out.text(m_default_state);
+            break;
 
         // the comb logic
-        auto default_outputs = outputs | views::transform([](std::string_view s){ return std::string(s) + " = '0;"; });
-        auto next_state_logic = fmt::format(
-            "always_comb begin : comb\n"
-            "{}\n"
-            "  next_state = present_state;\n"
-            "  case (present_state)\n"
-            "{}\n"
-            "    default : begin\n"
-            "      next_state = {};\n"
-            "    end\n"
-            "  endcase\n"
-            "end",
-            indent(join_non_empty_strings(default_outputs, "\n"), 1),
-            indent(join_non_empty_strings(case_states, "\n"), 2),
-            default_state
-        );
-
-        m_fsm_string = fmt::format(
-            "{}\n\n"
-            "{}\n\n"
-            "{}\n\n"
-            "{}\n\n"
-            "endmodule",
-            header,
-            states_declaration,
-            state_register,
-            next_state_logic
-        );
+        case Field::NextState:
+            write_section(m_style.m_comb);
+            break;
+        case Field::OutputsDefaults:
+        {
+            bool first = true;
+            for (const auto& [state, tree] : state_transition_map)
+            {
+                for (auto s : outputs_of(state))
+                {
+                    if (!std::exchange(first, false))
+                    {
+                        out.newline();
+                    }
+                    out.write("{} = '0;", m_symbols[s]);
+                }
+            }
+            break;
+        }
+        case Field::Cases:
+            if (m_keeping)
+            {
+                write_kept_cases(out);
+                break;
+            }
+            write_cases(out, state_transition_map);
+            break;
+        }
     }
 
-    auto FSMBuilder::write_transition_impl(
-        const std::unique_ptr<TransitionNode>& node
-    ) -> std::string
+    auto FSMBuilder::write_cases(Emitter& out, const StateTransitionMap& state_transition_map) -> void
     {
-        // never should have just m_right be non-null 
-        assert(node->m_left != nullptr && node->m_right == nullptr);
-
-        // once we are at the leaf nodes we can print the transition
-        if(node->m_left == nullptr && node->m_right == nullptr)
+        const std::span<const StateTransitionMap::value_type> arms(state_transition_map);
+        m_arms_written += arms.size();
+        if (m_n_workers <= 1 || arms.size() <= 1)
         {
-            return fmt::format("next_state = {};",  m_id_state_map[node->m_value.m_id]);
-        }
-        else if(node->m_left != nullptr && node->m_right != nullptr)
-        {   
-            // if there are children but not a decision block, then must be an error
-            assert(node->m_value.m_predicate.has_value());
-            return fmt::format(
-                "if({}) begin\n"
-                "{}\n"
-                "end else begin\n"
-                "{}\n"
-                "end",
-                node->m_value.m_predicate.value().to_string(),
-                indent(write_transition_impl(node->m_left), 1),
-                indent(write_transition_impl(node->m_right), 1)
-            );
+            write_arms(out, m_steps, arms);
+            return;
         }
-        // the start of the tree
-        else if (node->m_left != nullptr && node->m_right == nullptr)
+
+        // runs are small enough to share out, and are written a few per worker at a time, so a
+        // streamed module still only holds a bounded part of itself
+        constexpr std::size_t max_run_size = 256;
+        const auto run_size = std::clamp<std::size_t>(arms.size() / (4 * m_n_workers), 1, max_run_size);
+        const auto n_runs = (arms.size() + run_size - 1) / run_size;
+        const auto wave_size = std::min<std::size_t>(2 * m_n_workers, n_runs);
+
+        // each slot of a wave keeps its emitter, and so its storage, from one wave to the next
+        std::vector<Emitter> outs;
+        outs.reserve(wave_size);
+        for (std::size_t i = 0; i < wave_size; ++i)
         {
-            return write_transition_impl(node->m_left);
+            outs.emplace_back(m_style.m_indentation).align(out.indentation());
         }
-        else
+        std::vector<Steps> steps(wave_size);
+
+        utility::ThreadPool pool{static_cast<unsigned>(std::min<std::size_t>(m_n_workers, wave_size))};
+        for (std::size_t wave = 0; wave < n_runs; wave += wave_size)
         {
-            return std::string{};
+            const auto n = std::min(wave_size, n_runs - wave);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const auto first = (wave + i) * run_size;
+                const auto run = arms.subspan(first, std::min(run_size, arms.size() - first));
+                pool.submit([&, i, run]
+                {
+                    write_arms(outs[i], steps[i], run);
+                });
+            }
+            pool.wait();
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                if (wave + i != 0)
+                {
+                    out.newline();
+                }
+                out.splice(outs[i]);
+            }
         }
     }
 
-    auto FSMBuilder::write_transition(const TransitionTree& transition_tree) -> std::string
+    auto FSMBuilder::write_arms(
+        Emitter& out, 
+        Steps& steps, 
+        std::span<const StateTransitionMap::value_type> arms
+    ) const -> void
     {
-        const auto& root = transition_tree.m_root;
-        if (root != nullptr)
+        bool first = true;
+        for (const auto& [state, tree] : arms)
         {
-            return write_transition_impl(root);
+            if (!std::exchange(first, false))
+            {
+                out.newline();
+            }
+            write_case_state(out, steps, state, tree);
         }
+    }
+
+    auto FSMBuilder::write_transition(Emitter& out, Steps& steps, const TransitionTree& transition_tree) const -> void
+    {
         // an empty circuit
-        else 
+        if (transition_tree.empty())
+        {
+            return;
+        }
+
+        // a decision block opens its true branch, then is left to close it and write its
+        // false branch once that is written
+        constexpr auto npos = TransitionTree::npos;
+        steps.emplace_back(Step::Node, transition_tree.root());
+        while (!steps.empty())
         {
-            return std::string{};
+            const auto [step, index] = steps.back();
+            steps.pop_back();
+            switch (step)
+            {
+            case Step::Node:
+            {
+                const auto& node = transition_tree[index];
+
+                // never should have just m_right be non-null 
+                assert(!(node.m_left == npos && node.m_right != npos));
+
+                // once we are at the leaf nodes we can print the transition
+                if (node.m_left == npos && node.m_right == npos)
+                {
+                    out.write("next_state = {};", m_id_state_map[static_cast<std::size_t>(node.m_value.m_id)]);
+                }
+                else if (node.m_left != npos && node.m_right != npos)
+                {
+                    // if there are children but not a decision block, then must be an error
+                    assert(node.m_value.m_predicate.has_value());
+                    const auto& predicate = m_predicates[node.m_value.m_predicate.value()];
+                    if (predicate.m_comparator.has_value() && predicate.m_comparison_value.has_value())
+                    {
+                        out.write(
+                            "if({}{}{}) begin",
+                            m_symbols[predicate.m_variable],
+                            m_symbols[predicate.m_comparator.value()],
+                            m_symbols[predicate.m_comparison_value.value()]
+                        );
+                    }
+                    else
+                    {
+                        out.write("if({}) begin", m_symbols[predicate.m_variable]);
+                    }
+                    out.newline();
+                    out.indent();
+                    steps.emplace_back(Step::End, index);
+                    steps.emplace_back(Step::Node, node.m_right);
+                    steps.emplace_back(Step::Else, index);
+                    steps.emplace_back(Step::Node, node.m_left);
+                }
+                // the start of the tree
+                else if (node.m_left != npos)
+                {
+                    steps.emplace_back(Step::Node, node.m_left);
+                }
+                break;
+            }
+            case Step::Else:
+                out.dedent();
+                out.newline();
+                out.write("end else begin");
+                out.newline();
+                out.indent();
+                break;
+            case Step::End:
+                out.dedent();
+                out.newline();
+                out.write("end");
+                break;
+            }
         }
     }
 
     auto FSMBuilder::write_case_state(
-        std::string_view state_name,
+        Emitter& out,
+        Steps& steps,
         const parser::FSMState& state, 
         const TransitionTree& transition_tree
-    ) -> std::string
+    ) const -> void
     {
+        out.write("{} : begin", m_id_state_map[static_cast<std::size_t>(state.m_id)]);
+        out.newline();
+        out.indent();
         if (state.m_outputs.has_value())
         {
-            auto outputs = state.m_outputs.value()
-                | views::transform([](std::string_view s){ return std::string(s) + " = '1;"; });
-
-            return fmt::format(
-                "{} : begin\n"
-                "{}\n"
-                "{}\n"
-                "end",
-                state_name,
-                indent(join_non_empty_strings(outputs, "\n"), 1),
-                indent(write_transition(transition_tree), 1)
-            );
-        }
-        else 
-        {
-            return fmt::format(
-                "{} : begin\n"
-                "{}\n"
-                "end",
-                state_name,
-                indent(write_transition(transition_tree), 1)
-            );
+            bool first = true;
+            for (auto s : state.m_outputs.value())
+            {
+                if (!std::exchange(first, false))
+                {
+                    out.newline();
+                }
+                out.write("{} = '1;", m_symbols[s]);
+            }
+            out.dedent();
+            out.newline();
+            out.indent();
         }
+        write_transition(out, steps, transition_tree);
+        out.dedent();
+        out.newline();
+        out.write("end");
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,164 @@
+#include "../include/analysis.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <ranges>
+
+namespace model
+{
+    namespace ranges = std::ranges;
+
+    namespace helpers
+    {
+        // a set of positions, 64 to a word
+        class BitSet
+        {
+        public:
+            explicit BitSet(std::size_t n_bits)
+                : m_words((n_bits + 63) / 64, 0) {}
+
+            auto set(std::size_t bit) -> void
+            {
+                m_words[bit / 64] |= std::uint64_t{1} << (bit % 64);
+            }
+
+            auto test(std::size_t bit) const -> bool
+            {
+                return (m_words[bit / 64] >> (bit % 64)) & 1;
+            }
+
+            auto words() -> std::vector<std::uint64_t>&
+            {
+                return m_words;
+            }
+
+        private:
+            std::vector<std::uint64_t> m_words;
+        };
+    }
+
+    auto reset_state(
+        const States_t& states,
+        const StateTransitionMap& state_transition_map
+    ) -> std::optional<unsigned>
+    {
+        if (state_transition_map.empty())
+        {
+            return std::nullopt;
+        }
+
+        auto reset = state_transition_map.front().first.m_id;
+        for (const auto& [state, tree] : state_transition_map)
+        {
+            if (state.m_is_default_state)
+            {
+                reset = state.m_id;
+            }
+        }
+
+        // arrows resolve an id to the first state with it
+        auto state = ranges::find(states, reset, &parser::FSMState::m_id);
+        return static_cast<unsigned>(state - states.begin());
+    }
+
+    auto analyse_reachability(
+        const States_t& states,
+        const Predicates_t& predicates,
+        const TransitionMatrix& transition_matrix,
+        const StateTransitionMap& state_transition_map
+    ) -> Reachability
+    {
+        Reachability reachability;
+        for (unsigned i = 0; i < states.size(); ++i)
+        {
+            if (transition_matrix.successors(i).empty())
+            {
+                reachability.m_dead_end_states.push_back(i);
+            }
+        }
+
+        // without a transition there is no reset state, nor anything to reach
+        reachability.m_reset = reset_state(states, state_transition_map);
+        if (!reachability.m_reset.has_value())
+        {
+            return reachability;
+        }
+
+        // each level is the successors of the last, less anything already reached. Only the
+        // words a level touched are swept, so long chains do not sweep the whole graph each step
+        const auto rank = transition_matrix.rank();
+        helpers::BitSet reached(rank), level(rank), next(rank);
+        reached.set(reachability.m_reset.value());
+        level.set(reachability.m_reset.value());
+        std::vector<std::size_t> level_words{reachability.m_reset.value() / 64}, next_words;
+        while (!level_words.empty())
+        {
+            for (auto w : level_words)
+            {
+                for (auto bits = level.words()[w]; bits != 0; bits &= bits - 1)
+                {
+                    const auto pos = static_cast<unsigned>(w * 64 + static_cast<unsigned>(std::countr_zero(bits)));
+                    for (const auto& edge : transition_matrix.successors(pos))
+                    {
+                        if (next.words()[edge.m_target / 64] == 0)
+                        {
+                            next_words.push_back(edge.m_target / 64);
+                        }
+                        next.set(edge.m_target);
+                    }
+                }
+                level.words()[w] = 0;
+            }
+
+            level_words.clear();
+            for (auto w : next_words)
+            {
+                auto& bits = next.words()[w];
+                bits &= ~reached.words()[w];
+                reached.words()[w] |= bits;
+                if (bits != 0)
+                {
+                    level_words.push_back(w);
+                }
+            }
+            next_words.clear();
+            std::swap(level, next);
+        }
+
+        for (unsigned i = 0; i < states.size(); ++i)
+        {
+            if (!reached.test(i))
+            {
+                reachability.m_unreachable_states.push_back(i);
+            }
+        }
+        for (unsigned i = 0; i < predicates.size(); ++i)
+        {
+            if (!reached.test(states.size() + i))
+            {
+                reachability.m_unreached_predicates.push_back(i);
+            }
+        }
+        return reachability;
+    }
+
+    auto prune_unreachable(
+        StateTransitionMap& state_transition_map,
+        const States_t& states,
+        const Reachability& reachability
+    ) -> void
+    {
+        std::vector<parser::Symbol> unreachable;
+        for (auto i : reachability.m_unreachable_states)
+        {
+            unreachable.push_back(states[i].m_id);
+        }
+        ranges::sort(unreachable);
+
+        std::erase_if(state_transition_map, [&](const auto& entry)
+        {
+            return ranges::binary_search(unreachable, entry.first.m_id);
+        });
+    }
+}
@@ -1,47 +1,308 @@
 #include "../include/app.hpp"
 
 #include "../include/parser.hpp"
+#include "../include/decoder.hpp"
 #include "../include/FSM_builder.hpp"
 #include "../include/transition_matrix.hpp"
+#include "../include/analysis.hpp"
+#include "../include/minimise.hpp"
+#include "../include/thread_pool.hpp"
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
-#include <fstream>
+#include <map>
+#include <mutex>
+#include <ranges>
 
 namespace app
 {
-    auto run(const std::filesystem::path &path, Options options) -> void
+    static auto decode(std::string_view encoded_diagram, const Options &options) -> tl::expected<std::string, parser::ParseError>
+    {
+        if (options.legacy_decode)
+        {
+            return parser::base64_decode(encoded_diagram)
+                .and_then(parser::inflate)
+                .and_then(parser::url_decode);
+        }
+        return parser::decode_diagram(encoded_diagram);
+    }
+
+    // lists what can never take effect on stderr, one line each so batch runs stay greppable
+    static auto report_reachability(
+        const std::filesystem::path &path,
+        const States_t &states,
+        const Predicates_t &predicates,
+        const parser::SymbolTable &symbols,
+        const model::Reachability &reachability
+    ) -> void
+    {
+        auto state_name = [&](unsigned i)
+        {
+            const auto &state = states[i];
+            return state.m_state_name.has_value()
+                ? fmt::format("{} ({})", symbols[state.m_state_name.value()], symbols[state.m_id])
+                : std::string(symbols[state.m_id]);
+        };
+
+        std::string report;
+        for (auto i : reachability.m_unreachable_states)
+        {
+            report += fmt::format("{}: state {} is unreachable from the reset state\n", path.string(), state_name(i));
+        }
+        for (auto i : reachability.m_dead_end_states)
+        {
+            report += fmt::format("{}: state {} has no transitions out, so is left out of the module\n", path.string(), state_name(i));
+        }
+        for (auto i : reachability.m_unreached_predicates)
+        {
+            report += fmt::format("{}: decision block {} is never reached\n", path.string(), symbols[predicates[i].m_id]);
+        }
+        fmt::print(stderr, "{}", report);
+    }
+
+    static auto report_merged_states(
+        const std::filesystem::path &path,
+        const parser::SymbolTable &symbols,
+        const std::vector<model::MergedStates> &merged_states
+    ) -> void
+    {
+        auto state_name = [&](const parser::FSMState &state)
+        {
+            return state.m_state_name.has_value()
+                ? fmt::format("{} ({})", symbols[state.m_state_name.value()], symbols[state.m_id])
+                : std::string(symbols[state.m_id]);
+        };
+
+        std::string report;
+        for (const auto &[kept, merged] : merged_states)
+        {
+            report += fmt::format(
+                "{}: states {} merged into {}\n",
+                path.string(),
+                fmt::join(merged | std::views::transform(state_name), ", "),
+                state_name(kept)
+            );
+        }
+        fmt::print(stderr, "{}", report);
+    }
+
+    static auto build(
+        const std::filesystem::path &path, 
+        std::string_view encoded_diagram, 
+        const Options &options,
+        utility::Sink &sink
+    ) -> tl::expected<void, parser::ParseError>
     {
         // turn the encoded XML into tokens
         auto token_tuple =
-            parser::extract_encoded_drawio(path)
-                .and_then(parser::base64_decode)
-                .and_then(parser::inflate)
-                .and_then(parser::url_decode)
-                .and_then(parser::drawio_to_tokens)
-                .or_else(parser::HandleParseError);
+            decode(encoded_diagram, options)
+                .and_then(options.legacy_decode ? parser::drawio_to_tokens : parser::stream_drawio_to_tokens);
 
-        // break down the tuple into (s)tates, (p)redicates, and (a)rrows
-        auto &[s, p, a] = token_tuple.value();
+        if (!token_tuple)
+        {
+            return tl::unexpected<parser::ParseError>(token_tuple.error());
+        }
+
+        // break down the tuple into (s)tates, (p)redicates, (a)rrows and the strings they name
+        auto &[s, p, a, symbols] = token_tuple.value();
 
         // get the decisions
         model::TransitionMatrix m(s, a, p);
-        auto state_transition_map = model::build_transition_tree_map(s, p, m);
+        auto state_transition_map = model::build_transition_tree_map(
+            s, p, m, symbols, options.max_decision_nodes,
+            options.tree_jobs != 0 ? options.tree_jobs : std::thread::hardware_concurrency()
+        );
+        if (!state_transition_map)
+        {
+            return tl::unexpected<parser::ParseError>(state_transition_map.error());
+        }
 
-        // build the output string
-        fsm::FSMBuilder builder(state_transition_map);
+        // find, and if asked drop, the states which can never be entered
+        if (options.report_unreachable || options.prune_unreachable)
+        {
+            auto reachability = model::analyse_reachability(s, p, m, state_transition_map.value());
+            report_reachability(path, s, p, symbols, reachability);
+            if (options.prune_unreachable)
+            {
+                model::prune_unreachable(state_transition_map.value(), s, reachability);
+            }
+        }
+
+        if (options.minimise_states)
+        {
+            report_merged_states(path, symbols, model::minimise_states(state_transition_map.value(), s, p));
+        }
+
+        // stream the module out as it is written
+        fsm::FSMBuilder builder(
+            state_transition_map.value(), p, symbols,
+            options.house_style ? *options.house_style : fsm::HouseStyle::defaults(),
+            options.emit_jobs != 0 ? options.emit_jobs : std::thread::hardware_concurrency()
+        );
+        builder.write(sink);
+        return {};
+    }
 
-        // write the result        
-        if (options.out_file.has_value())
+    auto convert(
+        const std::filesystem::path &path, 
+        const Options &options,
+        cache::BuildCache *build_cache
+    ) -> tl::expected<std::string, parser::ParseError>
+    {
+        utility::StringSink sink;
+        if (auto converted = convert(path, options, sink, build_cache); !converted)
         {
-            std::ofstream output_file;
-            output_file.open(options.out_file.value(), std::ios::out | std::ios::trunc);
-            output_file << builder.write();
-            output_file.close();
+            return tl::unexpected<parser::ParseError>(converted.error());
         }
-        else 
+        return sink.take();
+    }
+
+    auto convert(
+        const std::filesystem::path &path, 
+        const Options &options,
+        utility::Sink &sink,
+        cache::BuildCache *build_cache
+    ) -> tl::expected<void, parser::ParseError>
+    {
+        auto drawio = parser::map_drawio_file(path);
+        if (!drawio)
+        {
+            return tl::unexpected<parser::ParseError>(drawio.error());
+        }
+
+        // the decode stages read straight from the mapped file
+        const auto diagram = drawio->m_diagrams.front();
+        // the reports come from analysing the diagram, which a cached module would skip
+        const bool reporting = options.report_unreachable || options.prune_unreachable || options.minimise_states;
+        if (build_cache == nullptr || reporting)
+        {
+            return build(path, diagram, options, sink);
+        }
+
+        // the cache keeps whole modules, so these are written to memory first
+        if (auto cached = build_cache->lookup(drawio->m_etag, diagram); cached.has_value())
+        {
+            sink.write(cached.value());
+            return {};
+        }
+        utility::StringSink fsm;
+        auto built = build(path, diagram, options, fsm);
+        if (built)
+        {
+            auto text = fsm.take();
+            build_cache->store(drawio->m_etag, diagram, text);
+            sink.write(text);
+        }
+        return built;
+    }
+
+    // the tool version and the templates change the generated text. Pruning and minimising do too,
+    // but their runs always report so never use the cache
+    static auto make_cache(const Options &options) -> std::optional<cache::BuildCache>
+    {
+        if (!options.cache_dir.has_value())
+        {
+            return std::nullopt;
+        }
+        auto salt = std::string(version);
+        if (options.house_style)
+        {
+            const auto& style = *options.house_style;
+            for (const auto* layout : {&style.m_module, &style.m_states, &style.m_register, &style.m_comb})
+            {
+                salt += "+template:";
+                salt += layout->source();
+            }
+        }
+        return std::make_optional<cache::BuildCache>(options.cache_dir.value(), salt, options.cache_max_entries);
+    }
+
+    static auto report_cache(std::optional<cache::BuildCache> &build_cache) -> void
+    {
+        if (build_cache.has_value())
+        {
+            build_cache->trim();
+            auto stats = build_cache->stats();
+            fmt::print(stderr, "cache: {} hits ({} by etag), {} misses, {} evictions\n",
+                stats.hits, stats.etag_hits, stats.misses, stats.evictions);
+        }
+    }
+
+    auto run(const std::filesystem::path &path, Options options) -> void
+    {
+        auto build_cache = make_cache(options);
+
+        // write the result to the output file, or stdout, as it is generated
+        utility::FileSink sink{options.out_file};
+        convert(path, options, sink, build_cache ? &build_cache.value() : nullptr).or_else(parser::HandleParseError);
+        if (!sink.close())
+        {
+            fmt::print(stderr, "could not write the output file {}\n", options.out_file.value_or("stdout").string());
+        }
+        report_cache(build_cache);
+    }
+
+    auto run(const std::vector<std::filesystem::path> &paths, Options options) -> unsigned
+    {
+        std::mutex report_mutex;
+        unsigned failures = 0;
+        auto report = [&](const std::filesystem::path &path, std::string_view message)
+        {
+            std::lock_guard lock{report_mutex};
+            fmt::print(stderr, "{}: {}\n", path.string(), message);
+            ++failures;
+        };
+
+        if (options.out_dir.has_value())
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(options.out_dir.value(), ec);
+        }
+
+        auto build_cache = make_cache(options);
+
+        // diagrams sharing a stem would overwrite each other, so only the first of them is converted
+        std::map<std::filesystem::path, std::filesystem::path> outputs;
+        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> work;
+        for (const auto &path : paths)
+        {
+            auto out_file = options.out_dir.value_or(path.parent_path()) / path.stem();
+            out_file.replace_extension(".sv");
+            auto [it, inserted] = outputs.emplace(std::filesystem::absolute(out_file).lexically_normal(), path);
+            if (!inserted)
+            {
+                report(path, fmt::format("the output file {} is also written for {}", out_file.string(), it->second.string()));
+                continue;
+            }
+            work.emplace_back(path, std::move(out_file));
+        }
+
+        utility::ThreadPool pool{options.jobs != 0 ? options.jobs : std::thread::hardware_concurrency()};
+        for (const auto &[path, out_file] : work)
         {
-            fmt::print("{}", builder.write());
+            pool.submit([&, path, out_file]
+            {
+                try
+                {
+                    utility::FileSink sink{out_file};
+                    if (auto fsm = convert(path, options, sink, build_cache ? &build_cache.value() : nullptr); !fsm)
+                    {
+                        report(path, parser::error_message(fsm.error()));
+                    }
+                    else if (!sink.close())
+                    {
+                        report(path, fmt::format("could not write the output file {}", out_file.string()));
+                    }
+                }
+                catch (const std::exception &err)
+                {
+                    report(path, err.what());
+                }
+            });
         }
+        pool.wait();
+        report_cache(build_cache);
+        return failures;
     }
-}
\ No newline at end of file
+}
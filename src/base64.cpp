@@ -0,0 +1,264 @@
+#include "../include/base64.hpp"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FSMIO_BASE64_X86
+#include <immintrin.h>
+#endif
+
+namespace parser::base64
+{
+    namespace helpers
+    {
+        // sextet for each byte of the alphabet, 0xFF for everything else
+        constexpr auto decode_table = []
+        {
+            std::array<std::uint8_t, 256> table{};
+            table.fill(0xFF);
+            constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (std::size_t i = 0; i < alphabet.size(); ++i)
+            {
+                table[static_cast<unsigned char>(alphabet[i])] = static_cast<std::uint8_t>(i);
+            }
+            return table;
+        }();
+
+        // decodes whole groups of 4, stopping before the first group holding an invalid byte.
+        // Returns the number of characters consumed, the bytes go to out
+        static auto decode_scalar(std::string_view in, unsigned char *&out) -> std::size_t
+        {
+            std::size_t i = 0;
+            for (; i + 4 <= in.size(); i += 4)
+            {
+                auto a = decode_table[static_cast<unsigned char>(in[i])];
+                auto b = decode_table[static_cast<unsigned char>(in[i + 1])];
+                auto c = decode_table[static_cast<unsigned char>(in[i + 2])];
+                auto d = decode_table[static_cast<unsigned char>(in[i + 3])];
+                if ((a | b | c | d) & 0x80)
+                {
+                    break;
+                }
+                std::uint32_t group = (std::uint32_t{a} << 18) | (std::uint32_t{b} << 12) | (std::uint32_t{c} << 6) | d;
+                *out++ = static_cast<unsigned char>(group >> 16);
+                *out++ = static_cast<unsigned char>(group >> 8);
+                *out++ = static_cast<unsigned char>(group);
+            }
+            return i;
+        }
+
+#ifdef FSMIO_BASE64_X86
+        // the vector decoders translate 16 characters per lane with nibble lookups (after
+        // W. Mula and D. Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions").
+        // lut_lo and lut_hi flag which (low, high) nibble pairs are outside the alphabet,
+        // lut_roll holds the offset from ascii to sextet for each high nibble
+
+        __attribute__((target("sse4.1")))
+        static auto decode_sse41(std::string_view in, unsigned char *&out) -> std::size_t
+        {
+            const __m128i lut_lo = _mm_setr_epi8(
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+            const __m128i lut_hi = _mm_setr_epi8(
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+            const __m128i lut_roll = _mm_setr_epi8(
+                0, 16, 19, 4, -65, -65, -71, -71,
+                0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i mask_2f = _mm_set1_epi8(0x2F);
+            const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+            // each step stores 16 bytes but only advances by 12, so stop while there is room
+            std::size_t i = 0;
+            for (; i + 24 <= in.size(); i += 16)
+            {
+                __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in.data() + i));
+                const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+                const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+                const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+                const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+                if (!_mm_testz_si128(lo, hi))
+                {
+                    break;
+                }
+                const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+                str = _mm_add_epi8(str, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+
+                // pack the 16 sextets into 12 bytes
+                const __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+                const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_shuffle_epi8(packed, pack));
+                out += 12;
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        static auto decode_avx2(std::string_view in, unsigned char *&out) -> std::size_t
+        {
+            const __m256i lut_lo = _mm256_setr_epi8(
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+            const __m256i lut_hi = _mm256_setr_epi8(
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+            const __m256i lut_roll = _mm256_setr_epi8(
+                0, 16, 19, 4, -65, -65, -71, -71,
+                0, 0, 0, 0, 0, 0, 0, 0,
+                0, 16, 19, 4, -65, -65, -71, -71,
+                0, 0, 0, 0, 0, 0, 0, 0);
+            const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+            const __m256i pack = _mm256_setr_epi8(
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+            const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+            // each step stores 32 bytes but only advances by 24
+            std::size_t i = 0;
+            for (; i + 45 <= in.size(); i += 32)
+            {
+                __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in.data() + i));
+                const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+                const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+                const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+                const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+                if (!_mm256_testz_si256(lo, hi))
+                {
+                    break;
+                }
+                const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+                str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+
+                // pack each lane's 16 sextets into 12 bytes, then close the gap between the lanes
+                const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+                const __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+                const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(packed, pack), gather);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), bytes);
+                out += 24;
+            }
+            return i;
+        }
+#endif
+
+        using decode_fn = auto (*)(std::string_view, unsigned char *&) -> std::size_t;
+
+        // the loop behind each kernel, the scalar one where there are no vector units
+        static auto kernel_decoder(Kernel kernel) -> decode_fn
+        {
+            switch (kernel)
+            {
+#ifdef FSMIO_BASE64_X86
+            case Kernel::avx2:
+                return decode_avx2;
+            case Kernel::sse41:
+                return decode_sse41;
+#else
+            case Kernel::avx2:
+            case Kernel::sse41:
+#endif
+            case Kernel::scalar:
+                break;
+            }
+            return decode_scalar;
+        }
+
+        // picks the widest decoder the cpu supports, once
+        static auto select_decoder() -> decode_fn
+        {
+            for (auto kernel : {Kernel::avx2, Kernel::sse41})
+            {
+                if (supported(kernel))
+                {
+                    return kernel_decoder(kernel);
+                }
+            }
+            return decode_scalar;
+        }
+
+        // the vector decoder runs ahead of the scalar loop, which finishes off the groups it leaves
+        static auto decode(std::string_view in, unsigned char *out, bool allow_padding, decode_fn vector_decode) -> std::optional<std::size_t>
+        {
+            unsigned char *first = out;
+
+            // padding only ever closes a whole group
+            if (allow_padding && in.size() % 4 == 0)
+            {
+                for (int pad = 0; pad < 2 && !in.empty() && in.back() == '='; ++pad)
+                {
+                    in.remove_suffix(1);
+                }
+            }
+            if (in.size() % 4 == 1)
+            {
+                return std::nullopt;
+            }
+
+            // the vector decoder stops early on anything unusual, the scalar loop then
+            // decodes what it can and whatever it stops on is a genuine error
+            std::size_t pos = vector_decode(in, out);
+            pos += helpers::decode_scalar(in.substr(pos), out);
+            in.remove_prefix(pos);
+            if (in.size() >= 4)
+            {
+                return std::nullopt;
+            }
+
+            // a final group of 2 or 3 sextets holds 1 or 2 bytes
+            std::uint32_t group = 0;
+            for (char c : in)
+            {
+                auto sextet = helpers::decode_table[static_cast<unsigned char>(c)];
+                if (sextet & 0x80)
+                {
+                    return std::nullopt;
+                }
+                group = (group << 6) | sextet;
+            }
+            if (in.size() == 2)
+            {
+                *out++ = static_cast<unsigned char>(group >> 4);
+            }
+            else if (in.size() == 3)
+            {
+                *out++ = static_cast<unsigned char>(group >> 10);
+                *out++ = static_cast<unsigned char>(group >> 2);
+            }
+            return static_cast<std::size_t>(out - first);
+        }
+    }
+
+    auto decode(std::string_view in, unsigned char *out, bool allow_padding) -> std::optional<std::size_t>
+    {
+        static const helpers::decode_fn vector_decode = helpers::select_decoder();
+        return helpers::decode(in, out, allow_padding, vector_decode);
+    }
+
+    auto supported(Kernel kernel) -> bool
+    {
+#ifdef FSMIO_BASE64_X86
+        __builtin_cpu_init();
+        switch (kernel)
+        {
+        case Kernel::avx2:
+            return __builtin_cpu_supports("avx2") != 0;
+        case Kernel::sse41:
+            return __builtin_cpu_supports("sse4.1") != 0;
+        case Kernel::scalar:
+            break;
+        }
+        return true;
+#else
+        return kernel == Kernel::scalar;
+#endif
+    }
+
+    auto decode(std::string_view in, unsigned char *out, bool allow_padding, Kernel kernel) -> std::optional<std::size_t>
+    {
+        return helpers::decode(in, out, allow_padding, helpers::kernel_decoder(kernel));
+    }
+}
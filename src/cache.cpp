@@ -0,0 +1,252 @@
+#include "../include/cache.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace cache
+{
+    namespace fs = std::filesystem;
+
+    namespace helpers
+    {
+        // 64 bit FNV-1a, chained so the salt and payload hash as one stream
+        static auto fnv1a(std::string_view bytes, std::uint64_t hash = 0xcbf29ce484222325ull) -> std::uint64_t
+        {
+            for (char c : bytes)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        static auto read_file(const fs::path& path) -> std::optional<std::string>
+        {
+            std::ifstream file(path, std::ios::in | std::ios::binary);
+            if (!file)
+            {
+                return std::nullopt;
+            }
+            std::ostringstream contents;
+            contents << file.rdbuf();
+            return contents.str();
+        }
+
+        // write to a temporary then rename, so readers never see a partial entry
+        static auto write_file(const fs::path& path, std::string_view contents) -> void
+        {
+            auto tmp = path;
+            tmp += fmt::format(".{}.{}.tmp", ::getpid(), std::hash<std::thread::id>{}(std::this_thread::get_id()));
+            {
+                std::ofstream file(tmp, std::ios::out | std::ios::trunc | std::ios::binary);
+                file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+                if (!file)
+                {
+                    return;
+                }
+            }
+            std::error_code ec;
+            fs::rename(tmp, path, ec);
+            if (ec)
+            {
+                fs::remove(tmp, ec);
+            }
+        }
+
+        // an entry starts with a line naming what it was built from: its key, the size of the
+        // payload and a second hash of it. An etag which now names another payload, or two
+        // payloads whose keys collide, are told apart by it rather than served the wrong module
+        static auto entry_header(std::uint64_t key, std::string_view payload) -> std::string
+        {
+            return fmt::format("{:016x} {} {:016x}\n", key, payload.size(), std::hash<std::string_view>{}(payload));
+        }
+
+        // the module of an entry, if it was built from the payload the header describes
+        static auto entry_module(std::string contents, std::string_view header) -> std::optional<std::string>
+        {
+            if (!std::string_view(contents).starts_with(header))
+            {
+                return std::nullopt;
+            }
+            contents.erase(0, header.size());
+            return contents;
+        }
+
+        // an etag record holds the etag and the header of the entry it was last seen with, which
+        // names the entry's file and the size of its payload
+        static auto etag_record(std::string_view etag, std::string_view header) -> std::string
+        {
+            return fmt::format("{}\n{}", etag, header);
+        }
+
+        // the header in a record of this etag for a payload of this size. draw.io writes a new etag
+        // on every save, so a match is trusted without hashing the payload
+        static auto record_header(std::string_view record, std::string_view etag, std::size_t payload_size) -> std::optional<std::string_view>
+        {
+            if (!record.starts_with(etag) || !record.substr(etag.size()).starts_with('\n'))
+            {
+                return std::nullopt;
+            }
+            const auto header = record.substr(etag.size() + 1);
+            const auto size = fmt::format(" {} ", payload_size);
+            if (header.size() <= 16 || !header.substr(16).starts_with(size))
+            {
+                return std::nullopt;
+            }
+            return header;
+        }
+
+        // the file of the entry a header belongs to, named by its key
+        static auto header_entry(std::string_view header) -> std::string
+        {
+            return fmt::format("{}.sv", header.substr(0, 16));
+        }
+
+        // hits refresh the modification time, which is what trim() orders by
+        static auto touch(const fs::path& path) -> void
+        {
+            std::error_code ec;
+            fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+        }
+    }
+
+    BuildCache::BuildCache(
+        const fs::path& directory,
+        std::string_view salt,
+        const unsigned max_entries
+    )
+        : m_directory{directory},
+          m_salt{salt},
+          m_max_entries{max_entries}
+    {
+        std::error_code ec;
+        fs::create_directories(m_directory, ec);
+    }
+
+    auto BuildCache::entry_path(std::uint64_t key) const -> fs::path
+    {
+        return m_directory / fmt::format("{:016x}.sv", key);
+    }
+
+    auto BuildCache::etag_path(std::string_view etag) const -> fs::path
+    {
+        return m_directory / fmt::format("{:016x}.etag", helpers::fnv1a(etag, helpers::fnv1a(m_salt)));
+    }
+
+    auto BuildCache::lookup(std::string_view etag, std::string_view payload) -> std::optional<std::string>
+    {
+        // the etag names the entry directly, without hashing the payload
+        if (!etag.empty())
+        {
+            if (auto record = helpers::read_file(etag_path(etag)); record.has_value())
+            {
+                if (auto header = helpers::record_header(record.value(), etag, payload.size()); header.has_value())
+                {
+                    auto entry = m_directory / helpers::header_entry(header.value());
+                    if (auto contents = helpers::read_file(entry); contents.has_value())
+                    {
+                        if (auto fsm = helpers::entry_module(std::move(contents.value()), header.value()); fsm.has_value())
+                        {
+                            helpers::touch(entry);
+                            ++m_hits;
+                            ++m_etag_hits;
+                            return fsm;
+                        }
+                    }
+                }
+            }
+        }
+
+        // otherwise the entry is found by the payload's key, and only served if it was built from this payload
+        const auto key = helpers::fnv1a(payload, helpers::fnv1a(m_salt));
+        const auto header = helpers::entry_header(key, payload);
+        auto entry = entry_path(key);
+        if (auto contents = helpers::read_file(entry); contents.has_value())
+        {
+            if (auto fsm = helpers::entry_module(std::move(contents.value()), header); fsm.has_value())
+            {
+                helpers::touch(entry);
+                if (!etag.empty())
+                {
+                    helpers::write_file(etag_path(etag), helpers::etag_record(etag, header));
+                }
+                ++m_hits;
+                return fsm;
+            }
+        }
+
+        ++m_misses;
+        return std::nullopt;
+    }
+
+    auto BuildCache::store(std::string_view etag, std::string_view payload, std::string_view fsm) -> void
+    {
+        const auto key = helpers::fnv1a(payload, helpers::fnv1a(m_salt));
+        const auto header = helpers::entry_header(key, payload);
+        helpers::write_file(entry_path(key), header + std::string(fsm));
+        if (!etag.empty())
+        {
+            helpers::write_file(etag_path(etag), helpers::etag_record(etag, header));
+        }
+    }
+
+    auto BuildCache::trim() -> void
+    {
+        std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+        std::vector<fs::path> etags;
+        std::error_code ec;
+        for (const auto& file : fs::directory_iterator(m_directory, ec))
+        {
+            if (file.path().extension() == ".sv")
+            {
+                entries.emplace_back(file.last_write_time(ec), file.path());
+            }
+            else if (file.path().extension() == ".etag")
+            {
+                etags.push_back(file.path());
+            }
+        }
+        if (entries.size() <= m_max_entries)
+        {
+            return;
+        }
+
+        // oldest first
+        auto n_evict = entries.size() - m_max_entries;
+        std::ranges::nth_element(entries, entries.begin() + static_cast<std::ptrdiff_t>(n_evict));
+        std::vector<std::string> evicted;
+        for (std::size_t i = 0; i < n_evict; ++i)
+        {
+            if (fs::remove(entries[i].second, ec))
+            {
+                evicted.push_back(entries[i].second.filename().string());
+                ++m_evictions;
+            }
+        }
+
+        // drop the etags which now point at nothing
+        std::ranges::sort(evicted);
+        for (const auto& etag : etags)
+        {
+            auto record = helpers::read_file(etag);
+            auto header = record.has_value() ? std::string_view(record.value()).substr(record->find('\n') + 1) : std::string_view{};
+            if (!record.has_value() || header.size() < 16 || std::ranges::binary_search(evicted, helpers::header_entry(header)))
+            {
+                fs::remove(etag, ec);
+            }
+        }
+    }
+
+    auto BuildCache::stats() const -> CacheStats
+    {
+        return CacheStats{m_hits, m_etag_hits, m_misses, m_evictions};
+    }
+}
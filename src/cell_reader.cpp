@@ -0,0 +1,363 @@
+#include "../include/cell_reader.hpp"
+
+#include <array>
+#include <algorithm>
+#include <utility>
+
+namespace parser::xml
+{
+    namespace helpers
+    {
+        static auto is_xml_space(char c) -> bool
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        static auto trim(std::string_view str) -> std::string_view
+        {
+            while (!str.empty() && is_xml_space(str.front())) str.remove_prefix(1);
+            while (!str.empty() && is_xml_space(str.back())) str.remove_suffix(1);
+            return str;
+        }
+
+        // position one past the '>' closing the tag which opens at pos, skipping quoted values
+        static auto find_tag_end(std::string_view xml, std::size_t pos) -> std::size_t
+        {
+            char quote = 0;
+            for (; pos < xml.size(); ++pos)
+            {
+                if (quote != 0)
+                {
+                    if (xml[pos] == quote) quote = 0;
+                }
+                else if (xml[pos] == '"' || xml[pos] == '\'')
+                {
+                    quote = xml[pos];
+                }
+                else if (xml[pos] == '>')
+                {
+                    return pos + 1;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        static auto append_utf8(std::string &out, unsigned long code_point) -> void
+        {
+            if (code_point < 0x80)
+            {
+                out += static_cast<char>(code_point);
+            }
+            else if (code_point < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (code_point >> 6));
+                out += static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            else if (code_point < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (code_point >> 12));
+                out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (code_point >> 18));
+                out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code_point & 0x3F));
+            }
+        }
+
+        // the code point of a &#NNN; or &#xHH; reference starting at str, and its length
+        static auto character_reference(std::string_view str) -> std::optional<std::pair<unsigned long, std::size_t>>
+        {
+            const bool hex = str.size() > 2 && str[2] == 'x';
+            const unsigned long base = hex ? 16 : 10;
+            unsigned long code_point = 0;
+            std::size_t pos = hex ? 3 : 2;
+            const auto first = pos;
+            for (; pos < str.size() && str[pos] != ';'; ++pos)
+            {
+                unsigned long digit;
+                char c = str[pos];
+                if (c >= '0' && c <= '9') digit = static_cast<unsigned long>(c - '0');
+                else if (hex && c >= 'a' && c <= 'f') digit = static_cast<unsigned long>(c - 'a' + 10);
+                else if (hex && c >= 'A' && c <= 'F') digit = static_cast<unsigned long>(c - 'A' + 10);
+                else return std::nullopt;
+
+                code_point = code_point * base + digit;
+                if (code_point > 0x10FFFF)
+                {
+                    return std::nullopt;
+                }
+            }
+            if (pos == first || pos == str.size())
+            {
+                return std::nullopt;
+            }
+            return std::make_pair(code_point, pos + 1);
+        }
+
+        // replaces the predefined entities and character references, and normalises line
+        // endings, as tinyxml2 does for attribute values. Unrecognised entities are kept
+        static auto decode_attribute(std::string_view raw, std::string &buffer) -> std::string_view
+        {
+            if (raw.find_first_of("&\r") == std::string_view::npos)
+            {
+                return raw;
+            }
+
+            constexpr std::array<std::pair<std::string_view, char>, 5> entities{{
+                {"&quot;", '"'}, {"&amp;", '&'}, {"&apos;", '\''}, {"&lt;", '<'}, {"&gt;", '>'}
+            }};
+
+            buffer.clear();
+            for (std::size_t pos = 0; pos < raw.size();)
+            {
+                const auto rest = raw.substr(pos);
+                if (rest[0] == '\r')
+                {
+                    buffer += '\n';
+                    pos += rest.starts_with("\r\n") ? 2u : 1u;
+                    continue;
+                }
+                if (rest[0] == '&')
+                {
+                    if (rest.starts_with("&#"))
+                    {
+                        if (auto reference = character_reference(rest); reference.has_value())
+                        {
+                            append_utf8(buffer, reference->first);
+                            pos += reference->second;
+                            continue;
+                        }
+                    }
+                    else
+                    {
+                        bool found = false;
+                        for (const auto &[entity, c] : entities)
+                        {
+                            if (rest.starts_with(entity))
+                            {
+                                buffer += c;
+                                pos += entity.size();
+                                found = true;
+                                break;
+                            }
+                        }
+                        if (found)
+                        {
+                            continue;
+                        }
+                    }
+                }
+                buffer += rest[0];
+                ++pos;
+            }
+            return buffer;
+        }
+    }
+
+    CellReader::CellReader(std::string_view xml)
+        : m_xml{xml}
+    {
+        m_open.reserve(16);
+    }
+
+    auto CellReader::next() -> tl::expected<std::optional<Cell>, ParseError>
+    {
+        while (true)
+        {
+            // text between tags carries nothing the tokens need
+            auto lt = m_xml.find('<', m_pos);
+            if (lt == std::string_view::npos)
+            {
+                if (!m_open.empty() || !m_seen_root)
+                {
+                    return tl::unexpected<ParseError>(ParseError::InvalidDecodedDrawioFile);
+                }
+                m_pos = m_xml.size();
+                return std::nullopt;
+            }
+            m_pos = lt;
+
+            const auto tag = m_xml.substr(m_pos);
+            if (tag.starts_with("<!") || tag.starts_with("<?"))
+            {
+                if (!skip_markup())
+                {
+                    return tl::unexpected<ParseError>(ParseError::InvalidDecodedDrawioFile);
+                }
+            }
+            else if (tag.starts_with("</"))
+            {
+                if (!close_tag())
+                {
+                    return tl::unexpected<ParseError>(ParseError::InvalidDecodedDrawioFile);
+                }
+            }
+            else
+            {
+                auto is_cell = open_tag();
+                if (!is_cell)
+                {
+                    return tl::unexpected<ParseError>(is_cell.error());
+                }
+                if (is_cell.value())
+                {
+                    return m_cell;
+                }
+            }
+        }
+    }
+
+    // comments, CDATA, processing instructions and declarations
+    auto CellReader::skip_markup() -> bool
+    {
+        const auto tag = m_xml.substr(m_pos);
+        std::string_view terminator = ">";
+        if (tag.starts_with("<!--"))
+        {
+            terminator = "-->";
+        }
+        else if (tag.starts_with("<![CDATA["))
+        {
+            terminator = "]]>";
+        }
+        else if (tag.starts_with("<?"))
+        {
+            terminator = "?>";
+        }
+
+        auto end = m_xml.find(terminator, m_pos + 2);
+        if (end == std::string_view::npos)
+        {
+            return false;
+        }
+        m_pos = end + terminator.size();
+        return true;
+    }
+
+    auto CellReader::close_tag() -> bool
+    {
+        auto end = m_xml.find('>', m_pos);
+        if (end == std::string_view::npos || m_open.empty())
+        {
+            return false;
+        }
+        auto name = helpers::trim(m_xml.substr(m_pos + 2, end - m_pos - 2));
+        if (name != m_open.back())
+        {
+            return false;
+        }
+        m_open.pop_back();
+
+        // </root> of the first document
+        if (m_in_root && m_open.size() == 1)
+        {
+            m_in_root = false;
+        }
+        m_pos = end + 1;
+        return true;
+    }
+
+    // true if the tag opens a styled cell, which is then in m_cell
+    auto CellReader::open_tag() -> tl::expected<bool, ParseError>
+    {
+        auto end = helpers::find_tag_end(m_xml, m_pos);
+        if (end == std::string_view::npos)
+        {
+            return tl::unexpected<ParseError>(ParseError::InvalidDecodedDrawioFile);
+        }
+
+        // everything between the '<' and '>'
+        auto tag = m_xml.substr(m_pos + 1, end - m_pos - 2);
+        const bool self_closing = !tag.empty() && tag.back() == '/';
+        if (self_closing)
+        {
+            tag.remove_suffix(1);
+        }
+        const auto name_end = std::min(tag.find_first_of(" \t\n\r"), tag.size());
+        const auto name = tag.substr(0, name_end);
+        if (name.empty())
+        {
+            return tl::unexpected<ParseError>(ParseError::InvalidDecodedDrawioFile);
+        }
+
+        // only the direct children of the first document's first <root> are cells
+        const auto depth = m_open.size();
+        if (depth == 0)
+        {
+            ++m_documents;
+        }
+        const bool is_cell = m_in_root && depth == 2 && name == "mxCell";
+        if (!read_attributes(tag.substr(name_end), is_cell))
+        {
+            return tl::unexpected<ParseError>(ParseError::InvalidDecodedDrawioFile);
+        }
+        if (m_documents == 1 && depth == 1 && !m_seen_root && name == "root")
+        {
+            m_seen_root = true;
+            m_in_root = !self_closing;
+        }
+
+        if (!self_closing)
+        {
+            m_open.push_back(name);
+        }
+        m_pos = end;
+        return is_cell && m_cell.m_style.has_value();
+    }
+
+    // checks the attributes are well formed, decoding the ones a cell needs if wanted
+    auto CellReader::read_attributes(std::string_view attributes, bool want) -> bool
+    {
+        if (want)
+        {
+            m_cell = Cell{};
+        }
+
+        std::size_t pos = 0;
+        while ((pos = attributes.find_first_not_of(" \t\n\r", pos)) != std::string_view::npos)
+        {
+            auto eq = attributes.find('=', pos);
+            if (eq == std::string_view::npos)
+            {
+                return false;
+            }
+            auto key = helpers::trim(attributes.substr(pos, eq - pos));
+            auto open = attributes.find_first_not_of(" \t\n\r", eq + 1);
+            if (key.empty() || open == std::string_view::npos || (attributes[open] != '"' && attributes[open] != '\''))
+            {
+                return false;
+            }
+            auto close = attributes.find(attributes[open], open + 1);
+            if (close == std::string_view::npos)
+            {
+                return false;
+            }
+            pos = close + 1;
+
+            if (!want)
+            {
+                continue;
+            }
+            std::optional<std::string_view> *slot = nullptr;
+            std::string *buffer = nullptr;
+            if (key == "id")          { slot = &m_cell.m_id;     buffer = &m_id_buffer; }
+            else if (key == "value")  { slot = &m_cell.m_value;  buffer = &m_value_buffer; }
+            else if (key == "style")  { slot = &m_cell.m_style;  buffer = &m_style_buffer; }
+            else if (key == "source") { slot = &m_cell.m_source; buffer = &m_source_buffer; }
+            else if (key == "target") { slot = &m_cell.m_target; buffer = &m_target_buffer; }
+            else continue;
+
+            // a repeated attribute is an error, as it is for tinyxml2
+            if (slot->has_value())
+            {
+                return false;
+            }
+            *slot = helpers::decode_attribute(attributes.substr(open + 1, close - open - 1), *buffer);
+        }
+        return true;
+    }
+}
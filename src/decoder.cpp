@@ -0,0 +1,77 @@
+#include "../include/decoder.hpp"
+#include "../include/base64.hpp"
+#include "../include/percent.hpp"
+#include "../include/inflater.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace parser
+{
+    namespace helpers
+    {
+        // base64 is consumed in chunks of this many characters, a multiple of 4 so
+        // that no partially decoded group is carried between chunks
+        constexpr std::size_t base64_chunk = 16384;
+    }
+
+    auto decode_diagram(std::string_view encoded_str) -> tl::expected<std::string, ParseError>
+    {
+        // the calling thread's inflater carries its zlib state over from the last diagram
+        auto &inflater = Inflater::local();
+        if (!inflater.begin())
+        {
+            return tl::unexpected<ParseError>(ParseError::InflationError);
+        }
+        z_stream &zs = inflater.stream();
+
+        std::string out(inflater.size_hint(encoded_str.size() / 4 * 3), '\0');
+        std::size_t decoded  = 0; // [0, decoded) is finished output
+        std::size_t inflated = 0; // [decoded, inflated) awaits percent decoding
+
+        std::array<unsigned char, base64::decoded_capacity(helpers::base64_chunk)> chunk;
+
+        int ret = Z_OK;
+        while (ret == Z_OK)
+        {
+            // refill zlib's input from the next run of base64, only the last may be padded
+            if (zs.avail_in == 0 && !encoded_str.empty())
+            {
+                auto in = encoded_str.substr(0, helpers::base64_chunk);
+                encoded_str.remove_prefix(in.size());
+                auto n_decoded = base64::decode(in, chunk.data(), encoded_str.empty());
+                if (!n_decoded.has_value())
+                {
+                    return tl::unexpected<ParseError>(ParseError::Base64DecodeError);
+                }
+                zs.next_in = chunk.data();
+                zs.avail_in = static_cast<uInt>(n_decoded.value());
+            }
+
+            if (inflated == out.size())
+            {
+                out.resize(out.size() * 2);
+            }
+            zs.next_out = reinterpret_cast<Bytef *>(out.data() + inflated);
+            zs.avail_out = static_cast<uInt>(out.size() - inflated);
+            ret = ::inflate(&zs, Z_NO_FLUSH);
+            inflated = out.size() - zs.avail_out;
+
+            // decode what has arrived, moving any cut off escape down to meet it
+            auto result = percent::decode(out.data() + decoded, out.data() + inflated, out.data() + decoded, ret == Z_STREAM_END);
+            auto pending = static_cast<std::size_t>(out.data() + inflated - result.rest);
+            std::memmove(result.out, result.rest, pending);
+            decoded = static_cast<std::size_t>(result.out - out.data());
+            inflated = decoded + pending;
+        }
+
+        if (ret != Z_STREAM_END)
+        {
+            return tl::unexpected<ParseError>(ParseError::InflationError);
+        }
+        inflater.finish();
+
+        out.resize(decoded);
+        return out;
+    }
+}
@@ -0,0 +1,77 @@
+#include "../include/emitter.hpp"
+
+#include <cstring>
+
+namespace fsm
+{
+    Emitter::Emitter(utility::Sink& sink, std::string_view indentation)
+        : m_sink{&sink}, m_unit{indentation}
+    {
+        m_buffer.reserve(spill_size + spill_size / 4);
+    }
+
+    auto Emitter::text(std::string_view str) -> void
+    {
+        for (auto end = str.find('\n'); end != std::string_view::npos; end = str.find('\n'))
+        {
+            m_buffer.append(str.substr(0, end));
+            newline();
+            str.remove_prefix(end + 1);
+        }
+        m_buffer.append(str);
+        spill();
+    }
+
+    auto Emitter::newline() -> void
+    {
+        m_buffer.push_back('\n');
+        m_buffer.append(m_indentation);
+        spill();
+    }
+
+    auto Emitter::indent(unsigned levels) -> void
+    {
+        const auto first = m_indentation.size();
+        for (unsigned i = 0; i < levels; ++i)
+        {
+            m_indentation.append(m_unit);
+        }
+        m_buffer.append(std::string_view(m_indentation).substr(first));
+    }
+
+    auto Emitter::dedent(unsigned levels) -> void
+    {
+        m_indentation.resize(m_indentation.size() - levels * m_unit.size());
+    }
+
+    auto Emitter::take() -> std::string
+    {
+        auto str = fmt::to_string(m_buffer);
+        m_buffer.clear();
+        m_indentation.clear();
+        return str;
+    }
+
+    auto Emitter::flush() -> void
+    {
+        if (m_sink != nullptr)
+        {
+            m_sink->write({m_buffer.data(), m_buffer.size()});
+            m_buffer.clear();
+        }
+    }
+
+    // formatted text rarely holds a newline, so it is written first and only moved
+    // aside to be rewritten when it does
+    auto Emitter::indent_newlines(std::size_t first) -> void
+    {
+        const auto *data = m_buffer.data() + first;
+        if (std::memchr(data, '\n', m_buffer.size() - first) == nullptr)
+        {
+            return;
+        }
+        const std::string written(data, m_buffer.size() - first);
+        m_buffer.resize(first);
+        text(written);
+    }
+}
@@ -0,0 +1,99 @@
+#include "../include/inflater.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <span>
+
+namespace parser
+{
+    Inflater::Inflater()
+        : m_initialised{false},
+          m_ratios{},
+          m_n_ratios{0},
+          m_next_ratio{0}
+    {
+        std::memset(&m_stream, 0, sizeof(m_stream));
+    }
+
+    Inflater::~Inflater()
+    {
+        if (m_initialised)
+        {
+            inflateEnd(&m_stream);
+        }
+    }
+
+    auto Inflater::local() -> Inflater&
+    {
+        thread_local Inflater inflater;
+        return inflater;
+    }
+
+    auto Inflater::begin() -> bool
+    {
+        if (!m_initialised)
+        {
+            m_initialised = inflateInit2(&m_stream, -MAX_WBITS) == Z_OK;
+            return m_initialised;
+        }
+        return inflateReset(&m_stream) == Z_OK;
+    }
+
+    auto Inflater::finish() -> void
+    {
+        if (m_stream.total_in != 0)
+        {
+            m_ratios[m_next_ratio] = static_cast<double>(m_stream.total_out) / static_cast<double>(m_stream.total_in);
+            m_next_ratio = (m_next_ratio + 1) % history_size;
+            m_n_ratios = std::min(m_n_ratios + 1, history_size);
+        }
+    }
+
+    auto Inflater::size_hint(std::size_t compressed) const -> std::size_t
+    {
+        // with no history, assume a small diagram, drawio payloads inflate by 3-10x
+        double ratio = 8.0;
+        if (m_n_ratios != 0)
+        {
+            auto recent = std::span(m_ratios).first(m_n_ratios);
+            ratio = std::accumulate(recent.begin(), recent.end(), 0.0) / static_cast<double>(m_n_ratios);
+        }
+        // a little headroom so an average diagram fits without growing
+        return static_cast<std::size_t>(static_cast<double>(compressed) * ratio * 1.25) + 4096;
+    }
+
+    auto Inflater::inflate(std::string_view compressed, std::string& out) -> bool
+    {
+        if (!begin())
+        {
+            return false;
+        }
+
+        out.resize(size_hint(compressed.size()));
+        m_stream.next_in = reinterpret_cast<const Bytef *>(compressed.data());
+        m_stream.avail_in = static_cast<uInt>(compressed.size());
+
+        int ret = Z_OK;
+        std::size_t produced = 0;
+        while (ret == Z_OK)
+        {
+            if (produced == out.size())
+            {
+                out.resize(out.size() * 2);
+            }
+            m_stream.next_out = reinterpret_cast<Bytef *>(out.data() + produced);
+            m_stream.avail_out = static_cast<uInt>(out.size() - produced);
+            ret = ::inflate(&m_stream, Z_NO_FLUSH);
+            produced = out.size() - m_stream.avail_out;
+        }
+
+        out.resize(produced);
+        if (ret != Z_STREAM_END)
+        {
+            return false;
+        }
+        finish();
+        return true;
+    }
+}
@@ -0,0 +1,180 @@
+#include "../include/lexer.hpp"
+
+#include <array>
+
+namespace parser::lexer
+{
+    namespace helpers
+    {
+        enum CharClass : unsigned char
+        {
+            Identifier = 1 << 0, // may appear in names, signals and variables
+            Output     = 1 << 1, // may appear in an output list
+            Value      = 1 << 2, // may appear in a comparison value
+        };
+
+        // [A-Za-z0-9_@./#&+-], plus ',' for output lists and '\'' for values (e.g. 2'b01)
+        constexpr auto char_classes = []
+        {
+            std::array<unsigned char, 256> classes{};
+            auto add = [&](std::string_view chars, unsigned char cls)
+            {
+                for (char c : chars)
+                {
+                    classes[static_cast<unsigned char>(c)] |= cls;
+                }
+            };
+            constexpr std::string_view identifier =
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_@./#&+-";
+            add(identifier, Identifier | Output | Value);
+            add(",", Output);
+            add("'", Value);
+            return classes;
+        }();
+
+        // true if str is non-empty and made only of characters of the class
+        static auto all_of_class(std::string_view str, CharClass cls) -> bool
+        {
+            if (str.empty())
+            {
+                return false;
+            }
+            for (char c : str)
+            {
+                if (!(char_classes[static_cast<unsigned char>(c)] & cls))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // length of the run of class characters at the start of str
+        static auto span_of_class(std::string_view str, CharClass cls) -> std::size_t
+        {
+            std::size_t n = 0;
+            while (n < str.size() && (char_classes[static_cast<unsigned char>(str[n])] & cls))
+            {
+                ++n;
+            }
+            return n;
+        }
+
+        // the list inside {<list>} if tok is exactly that
+        static auto braced_list(std::string_view tok) -> std::optional<std::string_view>
+        {
+            if (tok.size() > 2 && tok.front() == '{' && tok.back() == '}')
+            {
+                auto list = tok.substr(1, tok.size() - 2);
+                if (all_of_class(list, Output))
+                {
+                    return list;
+                }
+            }
+            return std::nullopt;
+        }
+    }
+
+    auto strip_tags(std::string_view text, std::string& buffer) -> std::string_view
+    {
+        auto open = text.find('<');
+        if (open == std::string_view::npos)
+        {
+            return text;
+        }
+
+        buffer.clear();
+        std::size_t pos = 0;
+        while (open != std::string_view::npos)
+        {
+            auto close = text.find('>', open);
+            if (close == std::string_view::npos)
+            {
+                break;
+            }
+            buffer.append(text, pos, open - pos);
+            pos = close + 1;
+            open = text.find('<', pos);
+        }
+        buffer.append(text, pos);
+        return buffer;
+    }
+
+    auto lex_state(std::string_view label) -> StateLabel
+    {
+        using namespace std::literals;
+
+        StateLabel state;
+        while (true)
+        {
+            auto end = label.find(';');
+            auto tok = label.substr(0, end);
+
+            if (tok == "$DEFAULT"sv)
+            {
+                state.m_is_default = true;
+            }
+            else if (tok.starts_with("$STATE="sv))
+            {
+                auto name = tok.substr(7);
+                if (!state.m_name && helpers::all_of_class(name, helpers::Identifier))
+                {
+                    state.m_name = name;
+                }
+            }
+            else if (tok.starts_with("$OUTPUTS="sv))
+            {
+                if (!state.m_outputs)
+                {
+                    state.m_outputs = helpers::braced_list(tok.substr(9));
+                }
+            }
+            else if (!state.m_outputs)
+            {
+                state.m_outputs = helpers::braced_list(tok);
+            }
+
+            if (end == std::string_view::npos)
+            {
+                break;
+            }
+            label.remove_prefix(end + 1);
+        }
+        return state;
+    }
+
+    auto lex_predicate(std::string_view label) -> tl::expected<PredicateLabel, ParseError>
+    {
+        auto n_variable = helpers::span_of_class(label, helpers::Identifier);
+        if (n_variable == 0)
+        {
+            return tl::unexpected<ParseError>(ParseError::IncorrectPredicateFormat);
+        }
+
+        auto variable = label.substr(0, n_variable);
+        auto rest = label.substr(n_variable);
+        if (rest.empty())
+        {
+            return PredicateLabel{variable, std::nullopt, std::nullopt};
+        }
+
+        // none of the comparator characters can appear in the value, so the longest
+        // comparator at this position is the only one which can be followed by a value
+        std::size_t n_comparator = 0;
+        if (rest.starts_with("==") || rest.starts_with("!=") || rest.starts_with("<=") || rest.starts_with(">="))
+        {
+            n_comparator = 2;
+        }
+        else if (rest.starts_with('<') || rest.starts_with('>'))
+        {
+            n_comparator = 1;
+        }
+
+        auto value = rest.substr(n_comparator);
+        if (n_comparator == 0 || !helpers::all_of_class(value, helpers::Value))
+        {
+            return tl::unexpected<ParseError>(ParseError::IncorrectPredicateFormat);
+        }
+        return PredicateLabel{variable, rest.substr(0, n_comparator), value};
+    }
+}
@@ -2,16 +2,63 @@
 
 #include <argparse/argparse.hpp>
 
+#include <algorithm>
+#include <cstdint>
+
 auto main(const int argc, char const * const * const argv) -> int
 {
     argparse::ArgumentParser program("FSM.io");
 
     program.add_argument("-d", "--diagram")
-        .required()
-        .default_value("../../resources/test.drawio")
-        .help("Specify the draw.io file you wish to convert.");
+        .append()
+        .help("Specify the draw.io file you wish to convert, repeat to convert several in one batch.");
+    program.add_argument("--diagram-dir")
+        .help("Convert every .drawio file in the given directory as one batch.");
     program.add_argument("-o", "--outfile")
         .help("Specify the file you wish to write the output of the conversion too (optional)");
+    program.add_argument("--outdir")
+        .help("Specify the directory batch conversions are written to (optional, defaults to beside each diagram)");
+    program.add_argument("-j", "--jobs")
+        .scan<'u', unsigned>()
+        .default_value(0u)
+        .help("Specify the number of worker threads used for batch conversions (optional)");
+    program.add_argument("--cache-dir")
+        .help("Specify a directory in which to cache generated modules, so unchanged diagrams are not rebuilt (optional)");
+    program.add_argument("--cache-max-entries")
+        .scan<'u', unsigned>()
+        .default_value(4096u)
+        .help("Specify the number of modules kept in the cache before the least recently used are evicted (optional)");
+
+    program.add_argument("--legacy-decode")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Decode diagrams through the separate base64, inflate and url decode stages and parse them into a DOM, rather than the fused streaming decoder and cell reader (optional)");
+    program.add_argument("--max-decision-nodes")
+        .scan<'u', std::uint64_t>()
+        .default_value(std::uint64_t{1} << 24)
+        .help("Specify the most nodes the if-statements of a diagram may have once every path through its decision blocks is written out, larger diagrams fail (optional)");
+    program.add_argument("--tree-jobs")
+        .scan<'u', unsigned>()
+        .default_value(1u)
+        .help("Specify the number of threads expanding the transition trees of each diagram, 0 for one per hardware thread (optional)");
+    program.add_argument("--emit-jobs")
+        .scan<'u', unsigned>()
+        .default_value(1u)
+        .help("Specify the number of threads writing the case statement of each module, 0 for one per hardware thread (optional)");
+    program.add_argument("--report-unreachable")
+        .default_value(false)
+        .implicit_value(true)
+        .help("List the states unreachable from the reset state, the states with no transitions out and the decision blocks never reached (optional)");
+    program.add_argument("--prune-unreachable")
+        .default_value(false)
+        .implicit_value(true)
+        .help("As --report-unreachable, and leave the unreachable states out of the module (optional)");
+    program.add_argument("--minimise-states")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Merge the states which behave the same, listing the states merged (optional)");
+    program.add_argument("--template-dir")
+        .help("Specify a directory of FSM_template.sv, state_template.sv, state_register_template.sv and nest_state_template.sv to lay modules out by, such as resources/fsm (optional)");
 
     try {
         program.parse_args(argc, argv);
@@ -22,15 +69,81 @@ auto main(const int argc, char const * const * const argv) -> int
         std::exit(1);
     }
 
+    // gather the diagrams to convert
+    std::vector<std::filesystem::path> infiles;
+    if (auto d = program.present<std::vector<std::string>>("-d"))
+    {
+        infiles.assign(d->begin(), d->end());
+    }
+    if (auto dir = program.present("--diagram-dir"))
+    {
+        const auto first = infiles.size();
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(*dir, ec))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".drawio")
+            {
+                infiles.push_back(entry.path());
+            }
+        }
+        if (ec)
+        {
+            std::cerr << "could not read the diagram directory " << *dir << std::endl;
+            std::exit(1);
+        }
+        std::sort(infiles.begin() + static_cast<std::ptrdiff_t>(first), infiles.end());
+    }
+    if (infiles.empty())
+    {
+        std::cerr << "one of --diagram or --diagram-dir is required" << std::endl;
+        std::cerr << program;
+        std::exit(1);
+    }
+
     // set up the optional arguments
     app::Options options;
-    if (auto o = program.present("-o")) 
+    if (auto o = program.present("-o"))
     {
+        if (infiles.size() != 1 || program.is_used("--diagram-dir"))
+        {
+            std::cerr << "--outfile takes a single diagram, use --outdir for several" << std::endl;
+            std::exit(1);
+        }
         options.out_file = std::filesystem::path{*o};
     }
+    if (auto o = program.present("--outdir"))
+    {
+        options.out_dir = std::filesystem::path{*o};
+    }
+    options.jobs = program.get<unsigned>("-j");
+    if (auto c = program.present("--cache-dir"))
+    {
+        options.cache_dir = std::filesystem::path{*c};
+    }
+    options.cache_max_entries = program.get<unsigned>("--cache-max-entries");
+    options.legacy_decode = program.get<bool>("--legacy-decode");
+    options.max_decision_nodes = program.get<std::uint64_t>("--max-decision-nodes");
+    options.tree_jobs = program.get<unsigned>("--tree-jobs");
+    options.emit_jobs = program.get<unsigned>("--emit-jobs");
+    options.report_unreachable = program.get<bool>("--report-unreachable");
+    options.prune_unreachable = program.get<bool>("--prune-unreachable");
+    options.minimise_states = program.get<bool>("--minimise-states");
+    if (auto t = program.present("--template-dir"))
+    {
+        auto style = fsm::HouseStyle::load(*t);
+        if (!style)
+        {
+            std::cerr << style.error() << std::endl;
+            std::exit(1);
+        }
+        options.house_style = std::make_shared<const fsm::HouseStyle>(std::move(style.value()));
+    }
 
     // run with the options and the required arguments
-    const std::filesystem::path infile{program.get("-d")};
-    app::run(infile, options);
-    return 0;
+    if (infiles.size() == 1 && !program.is_used("--diagram-dir"))
+    {
+        app::run(infiles.front(), options);
+        return 0;
+    }
+    return app::run(infiles, options) == 0 ? 0 : 1;
 }
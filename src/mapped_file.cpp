@@ -0,0 +1,58 @@
+#include "../include/mapped_file.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace utility
+{
+    auto MappedFile::open(const std::filesystem::path& path) -> tl::expected<MappedFile, int>
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return tl::unexpected<int>(errno);
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            return tl::unexpected<int>(err);
+        }
+
+        // mmap refuses zero length mappings, an empty file is just an empty view
+        auto size = static_cast<std::size_t>(info.st_size);
+        if (size == 0)
+        {
+            ::close(fd);
+            return MappedFile{};
+        }
+
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            return tl::unexpected<int>(err);
+        }
+
+        // the file is scanned front to back exactly once
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        return MappedFile{static_cast<const char*>(data), size};
+    }
+
+    auto MappedFile::unmap() -> void
+    {
+        if (m_data != nullptr)
+        {
+            ::munmap(const_cast<char*>(m_data), m_size);
+            m_data = nullptr;
+            m_size = 0;
+        }
+    }
+}
@@ -0,0 +1,405 @@
+#include "../include/minimise.hpp"
+#include "../include/analysis.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <ranges>
+#include <span>
+
+namespace model
+{
+    namespace ranges = std::ranges;
+
+    namespace helpers
+    {
+        // a partition of the elements 0..n-1 whose sets are split by marking some of their
+        // elements. Each set is a range of m_elements, with its marked elements at the front
+        class RefinablePartition
+        {
+        public:
+            // the elements start in the sets set_of numbers them by, from 0 to n_sets-1
+            RefinablePartition(std::span<const unsigned> set_of, unsigned n_sets)
+                : m_elements(set_of.size()),
+                  m_location(set_of.size()),
+                  m_set(set_of.begin(), set_of.end()),
+                  m_first(set_of.size(), 0),
+                  m_past(set_of.size(), 0),
+                  m_marked(set_of.size(), 0),
+                  m_n_sets{n_sets}
+            {
+                for (auto set : set_of)
+                {
+                    ++m_past[set];
+                }
+                unsigned first = 0;
+                for (unsigned set = 0; set < n_sets; ++set)
+                {
+                    m_first[set] = first;
+                    first += std::exchange(m_past[set], first);
+                }
+                for (unsigned element = 0; element < set_of.size(); ++element)
+                {
+                    m_location[element] = m_past[set_of[element]]++;
+                    m_elements[m_location[element]] = element;
+                }
+            }
+
+            auto size() const -> unsigned { return m_n_sets; }
+
+            auto set_of(unsigned element) const -> unsigned { return m_set[element]; }
+
+            auto elements(unsigned set) const -> std::span<const unsigned>
+            {
+                return std::span(m_elements).subspan(m_first[set], m_past[set] - m_first[set]);
+            }
+
+            // moves an element to the marked front of its set
+            auto mark(unsigned element) -> void
+            {
+                const auto set = m_set[element];
+                const auto i = m_location[element];
+                const auto j = m_first[set] + m_marked[set];
+                if (i < j)
+                {
+                    return;
+                }
+                m_elements[i] = m_elements[j];
+                m_location[m_elements[i]] = i;
+                m_elements[j] = element;
+                m_location[element] = j;
+                if (m_marked[set]++ == 0)
+                {
+                    m_touched.push_back(set);
+                }
+            }
+
+            // splits each set with marked elements in two, the smaller half becoming the new set
+            auto split() -> void
+            {
+                for (auto set : m_touched)
+                {
+                    const auto j = m_first[set] + m_marked[set];
+                    if (j == m_past[set])
+                    {
+                        m_marked[set] = 0;
+                        continue;
+                    }
+
+                    const auto added = m_n_sets++;
+                    if (m_marked[set] <= m_past[set] - j)
+                    {
+                        m_first[added] = m_first[set];
+                        m_past[added] = m_first[set] = j;
+                    }
+                    else
+                    {
+                        m_past[added] = m_past[set];
+                        m_first[added] = m_past[set] = j;
+                    }
+                    for (auto i = m_first[added]; i < m_past[added]; ++i)
+                    {
+                        m_set[m_elements[i]] = added;
+                    }
+                    m_marked[set] = m_marked[added] = 0;
+                }
+                m_touched.clear();
+            }
+
+        private:
+            std::vector<unsigned> m_elements;
+            std::vector<unsigned> m_location; // of each element in m_elements
+            std::vector<unsigned> m_set;      // of each element
+            std::vector<unsigned> m_first;    // of each set in m_elements
+            std::vector<unsigned> m_past;     // the end of each set in m_elements
+            std::vector<unsigned> m_marked;   // number of elements marked in each set
+            std::vector<unsigned> m_touched;  // the sets with marked elements
+            unsigned m_n_sets;
+        };
+
+        // the text a state's arm writes, less the states it moves to: its outputs, then the
+        // nodes of its tree in pre-order. The states it moves to are listed in the same order
+        struct Arm
+        {
+            enum Token : std::uint32_t
+            {
+                Decision,
+                State,
+                Other,
+                Empty
+            };
+
+            std::vector<std::uint32_t> m_shape;
+            std::vector<unsigned> m_targets;
+        };
+
+        using NumberedStates = std::vector<std::pair<parser::Symbol, unsigned>>;
+
+        static auto number_of(const NumberedStates& numbered, parser::Symbol id) -> std::optional<unsigned>
+        {
+            auto it = ranges::lower_bound(numbered, id, {}, &NumberedStates::value_type::first);
+            if (it == numbered.end() || it->first != id)
+            {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        static auto describe_arm(
+            const parser::FSMState& state,
+            const TransitionTree& tree,
+            const Predicates_t& predicates,
+            const NumberedStates& numbered
+        ) -> Arm
+        {
+            Arm arm;
+            auto outputs = state.m_outputs.value_or(std::vector<parser::Symbol>{});
+            ranges::sort(outputs);
+            outputs.erase(ranges::unique(outputs).begin(), outputs.end());
+            arm.m_shape.push_back(static_cast<std::uint32_t>(outputs.size()));
+            for (auto output : outputs)
+            {
+                arm.m_shape.push_back(static_cast<std::uint32_t>(output));
+            }
+
+            // read as FSMBuilder writes it, so arms which read the same behave the same
+            constexpr auto npos = TransitionTree::npos;
+            std::vector<TransitionTree::index_type> pending;
+            if (!tree.empty())
+            {
+                pending.push_back(tree.root());
+            }
+            while (!pending.empty())
+            {
+                const auto& node = tree[pending.back()];
+                pending.pop_back();
+                if (node.m_left == npos && node.m_right == npos)
+                {
+                    auto target = node.m_value.m_predicate.has_value()
+                        ? std::nullopt
+                        : number_of(numbered, node.m_value.m_id);
+                    if (target.has_value())
+                    {
+                        arm.m_shape.push_back(Arm::State);
+                        arm.m_targets.push_back(target.value());
+                    }
+                    else
+                    {
+                        arm.m_shape.push_back(Arm::Other);
+                        arm.m_shape.push_back(static_cast<std::uint32_t>(node.m_value.m_id));
+                    }
+                }
+                else if (node.m_left != npos && node.m_right != npos)
+                {
+                    const auto& predicate = predicates[node.m_value.m_predicate.value()];
+                    arm.m_shape.push_back(Arm::Decision);
+                    arm.m_shape.push_back(static_cast<std::uint32_t>(predicate.m_variable));
+                    arm.m_shape.push_back(predicate.m_comparator.has_value() ? static_cast<std::uint32_t>(predicate.m_comparator.value()) + 1 : 0);
+                    arm.m_shape.push_back(predicate.m_comparison_value.has_value() ? static_cast<std::uint32_t>(predicate.m_comparison_value.value()) + 1 : 0);
+                    pending.push_back(node.m_right);
+                    pending.push_back(node.m_left);
+                }
+                else if (node.m_left != npos)
+                {
+                    pending.push_back(node.m_left);
+                }
+                else
+                {
+                    arm.m_shape.push_back(Arm::Empty);
+                }
+            }
+            return arm;
+        }
+    }
+
+    auto minimise_states(
+        StateTransitionMap& state_transition_map,
+        const States_t& states,
+        const Predicates_t& predicates
+    ) -> std::vector<MergedStates>
+    {
+        // number the states with a transition in the order of their first, which is their arm
+        std::vector<std::pair<parser::Symbol, std::size_t>> first_entries;
+        for (std::size_t i = 0; i < state_transition_map.size(); ++i)
+        {
+            first_entries.emplace_back(state_transition_map[i].first.m_id, i);
+        }
+        ranges::sort(first_entries);
+        first_entries.erase(ranges::unique(first_entries, {}, &decltype(first_entries)::value_type::first).begin(), first_entries.end());
+
+        std::vector<std::size_t> arm_entry;
+        for (const auto& [id, i] : first_entries)
+        {
+            arm_entry.push_back(i);
+        }
+        ranges::sort(arm_entry);
+        const auto n_states = static_cast<unsigned>(arm_entry.size());
+
+        helpers::NumberedStates numbered;
+        for (unsigned k = 0; k < n_states; ++k)
+        {
+            numbered.emplace_back(state_transition_map[arm_entry[k]].first.m_id, k);
+        }
+        ranges::sort(numbered);
+
+        std::vector<helpers::Arm> arms;
+        for (auto i : arm_entry)
+        {
+            const auto& [state, tree] = state_transition_map[i];
+            arms.push_back(helpers::describe_arm(state, tree, predicates, numbered));
+        }
+
+        // states start out together when their arms read the same but for the states they
+        // move to. The i-th state an arm moves to is its transition labelled i
+        std::vector<unsigned> by_shape(n_states);
+        std::iota(by_shape.begin(), by_shape.end(), 0u);
+        ranges::stable_sort(by_shape, [&](unsigned a, unsigned b)
+        {
+            return arms[a].m_shape < arms[b].m_shape;
+        });
+
+        std::vector<unsigned> shape_of(n_states);
+        unsigned n_shapes = 0;
+        for (unsigned i = 0; i < n_states; ++i)
+        {
+            if (i != 0 && arms[by_shape[i]].m_shape != arms[by_shape[i - 1]].m_shape)
+            {
+                ++n_shapes;
+            }
+            shape_of[by_shape[i]] = n_shapes;
+        }
+        n_shapes += n_states != 0;
+
+        std::vector<unsigned> tails, heads, labels;
+        for (unsigned k = 0; k < n_states; ++k)
+        {
+            for (unsigned i = 0; i < arms[k].m_targets.size(); ++i)
+            {
+                tails.push_back(k);
+                heads.push_back(arms[k].m_targets[i]);
+                labels.push_back(i);
+            }
+        }
+        const auto n_labels = labels.empty() ? 0u : ranges::max(labels) + 1;
+
+        // the transitions into each state
+        std::vector<unsigned> incoming_first(n_states + 1, 0), incoming(heads.size());
+        for (auto head : heads)
+        {
+            ++incoming_first[head + 1];
+        }
+        std::partial_sum(incoming_first.begin(), incoming_first.end(), incoming_first.begin());
+        {
+            auto next = incoming_first;
+            for (unsigned t = 0; t < heads.size(); ++t)
+            {
+                incoming[next[heads[t]]++] = t;
+            }
+        }
+
+        // split the blocks of states by the transitions into each block, and the cords of
+        // transitions by the block they leave, until neither splits. Cords start as all the
+        // transitions with a label, so the first block is never needed to split them
+        helpers::RefinablePartition blocks(shape_of, n_shapes);
+        helpers::RefinablePartition cords(labels, n_labels);
+        unsigned block = 1;
+        for (unsigned cord = 0; cord < cords.size(); ++cord)
+        {
+            for (auto t : cords.elements(cord))
+            {
+                blocks.mark(tails[t]);
+            }
+            blocks.split();
+
+            for (; block < blocks.size(); ++block)
+            {
+                for (auto k : blocks.elements(block))
+                {
+                    for (auto i = incoming_first[k]; i < incoming_first[k + 1]; ++i)
+                    {
+                        cords.mark(incoming[i]);
+                    }
+                }
+                cords.split();
+            }
+        }
+
+        if (blocks.size() == n_states)
+        {
+            return {};
+        }
+
+        // keep the first state of each block, or the reset state so the module resets the same
+        std::vector<unsigned> kept(blocks.size(), n_states);
+        for (unsigned k = 0; k < n_states; ++k)
+        {
+            if (kept[blocks.set_of(k)] == n_states)
+            {
+                kept[blocks.set_of(k)] = k;
+            }
+        }
+        if (auto reset = reset_state(states, state_transition_map); reset.has_value())
+        {
+            const auto k = helpers::number_of(numbered, states[reset.value()].m_id).value();
+            kept[blocks.set_of(k)] = k;
+        }
+
+        std::vector<std::pair<unsigned, unsigned>> kept_merged;
+        std::vector<parser::FSMState> arm_state;
+        for (unsigned k = 0; k < n_states; ++k)
+        {
+            arm_state.push_back(state_transition_map[arm_entry[k]].first);
+            if (kept[blocks.set_of(k)] != k)
+            {
+                kept_merged.emplace_back(kept[blocks.set_of(k)], k);
+            }
+        }
+        ranges::sort(kept_merged);
+
+        std::vector<MergedStates> merged;
+        for (const auto& [k, m] : kept_merged)
+        {
+            if (merged.empty() || merged.back().m_kept.m_id != arm_state[k].m_id)
+            {
+                merged.push_back(MergedStates{arm_state[k], {}});
+            }
+            merged.back().m_merged.push_back(arm_state[m]);
+        }
+
+        // drop the arms of the merged states, and point the transitions into them at the
+        // state they merged into. The graphs are shared, so each is rewritten once
+        auto kept_id = [&](parser::Symbol id)
+        {
+            auto k = helpers::number_of(numbered, id);
+            return k.has_value() ? arm_state[kept[blocks.set_of(k.value())]].m_id : id;
+        };
+        std::erase_if(state_transition_map, [&](const auto& entry)
+        {
+            return kept_id(entry.first.m_id) != entry.first.m_id;
+        });
+
+        constexpr auto npos = TransitionTree::npos;
+        std::vector<std::pair<const TransitionGraph*, std::shared_ptr<const TransitionGraph>>> rewritten;
+        for (auto& [state, tree] : state_transition_map)
+        {
+            auto graph = ranges::find(rewritten, tree.nodes().get(), &decltype(rewritten)::value_type::first);
+            if (graph == rewritten.end())
+            {
+                auto nodes = std::make_shared<TransitionGraph>(*tree.nodes());
+                for (TransitionGraph::index_type i = 0; i < nodes->size(); ++i)
+                {
+                    auto& node = (*nodes)[i];
+                    if (node.m_left == npos && node.m_right == npos && !node.m_value.m_predicate.has_value())
+                    {
+                        node.m_value.m_id = kept_id(node.m_value.m_id);
+                    }
+                }
+                rewritten.emplace_back(tree.nodes().get(), std::move(nodes));
+                graph = std::prev(rewritten.end());
+            }
+            tree = TransitionTree{graph->second, tree.root()};
+        }
+        return merged;
+    }
+}
@@ -1,4 +1,10 @@
 #include "../include/parser.hpp"
+#include "../include/base64.hpp"
+#include "../include/percent.hpp"
+#include "../include/inflater.hpp"
+#include "../include/lexer.hpp"
+#include "../include/cell_reader.hpp"
+#include "../include/style.hpp"
 #include "../include/FSM_elements.hpp"
 #include "../include/tree.hpp"
 #include "../include/utility.hpp"
@@ -12,10 +18,7 @@
 #include <cassert>
 #include <utility>
 #include <algorithm>
-#include <regex>
 
-#include <zlib.h>
-#include <curl/curl.h>
 #include <tinyxml2.h>
 #include <fmt/format.h>
 
@@ -26,10 +29,18 @@ namespace parser
     namespace views = std::views;
     namespace ranges = std::ranges;
 
-    // type aliases
-    using TransitionTree = utility::binary_tree<FSMTransition>;
-    using TransitionNode = utility::Node<FSMTransition>;
-    using TransitionMatrix = std::vector<std::vector<std::optional<bool>>>;
+    // a cell along with its style, split once for the classifier and token builders
+    struct StyledCell
+    {
+        xml::Cell m_cell;
+        style::Style m_style;
+    };
+
+    // where the tags are stripped from a cell's attributes, reused from cell to cell
+    struct LabelBuffers
+    {
+        std::string m_id, m_value, m_source, m_target;
+    };
 
     // helper functions
     namespace helpers
@@ -53,23 +64,11 @@ namespace parser
             } 
         }
 
-        // checks if a given xmCell element is a given type based on its "style"
-        static auto elem_is_type(XMLElement *element, std::string_view test_type) -> bool
+        // strips the html markup draw.io adds to labels (fonts, sizes, line breaks).
+        // The result views either the attribute itself or the buffer
+        static auto sanitise(std::optional<std::string_view> attribute, std::string &buffer) -> std::string_view
         {
-            if (auto style = element->Attribute("style"); style != nullptr)
-            {
-                auto res = std::string_view{style} | views::split(';') | ranges::views::filter([test_type](auto &&r)
-                                                                                               {
-                        auto actual_type = std::string_view(r.begin(), r.end());
-                        return actual_type == test_type; });
-                return !res.empty();
-            }
-            return false;
-        };
-
-        static auto sanitise(std::string_view s)
-        {
-            return std::regex_replace(std::string(s), std::regex("<[^>]*>"), "");
+            return lexer::strip_tags(attribute.value_or(""), buffer);
         }
 
         template <typename T>
@@ -78,26 +77,119 @@ namespace parser
             return !e.has_value();
         }
 
-        // specialisations of elem type checked lambda
-        static auto is_predicate(XMLElement *element)
+        static auto with_style(const xml::Cell &cell) -> StyledCell
+        {
+            return StyledCell{cell, style::parse(cell.m_style.value_or(""))};
+        }
+
+        // a cell's category, from the kinds its style names
+        static auto is_predicate(const StyledCell &element)
         {
-            return elem_is_type(element, "rhombus");
+            return element.m_style.is(style::Rhombus);
         };
 
-        static auto is_arrow(XMLElement *element)
+        static auto is_arrow(const StyledCell &element)
         {
-            return elem_is_type(element, "edgeStyle=orthogonalEdgeStyle");
+            return element.m_style.is(style::OrthogonalEdge);
         };
 
-        static auto is_text(XMLElement *element)
+        static auto is_text(const StyledCell &element)
         {
-            return elem_is_type(element, "text");
+            return element.m_style.is(style::Text);
         };
 
-        static auto is_state(XMLElement *element)
+        static auto is_state(const StyledCell &element)
         {
             return !is_predicate(element) & !is_arrow(element) & !is_text(element);
         };
+
+        static auto is_xml_space(char c) -> bool
+        {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        static auto trim(std::string_view str) -> std::string_view
+        {
+            while (!str.empty() && is_xml_space(str.front())) str.remove_prefix(1);
+            while (!str.empty() && is_xml_space(str.back())) str.remove_suffix(1);
+            return str;
+        }
+
+        // position of the '<' of the next <name ...> start tag at or after pos
+        static auto find_start_tag(std::string_view xml, std::string_view name, std::size_t pos) -> std::size_t
+        {
+            while ((pos = xml.find('<', pos)) != std::string_view::npos)
+            {
+                auto tag = xml.substr(pos + 1);
+                if (tag.starts_with(name) && tag.size() > name.size())
+                {
+                    char next = tag[name.size()];
+                    if (next == '>' || next == '/' || is_xml_space(next))
+                    {
+                        return pos;
+                    }
+                }
+                ++pos;
+            }
+            return std::string_view::npos;
+        }
+
+        // position one past the '>' closing the tag which opens at pos, skipping quoted values
+        static auto find_tag_end(std::string_view xml, std::size_t pos) -> std::size_t
+        {
+            if (pos == std::string_view::npos)
+            {
+                return pos;
+            }
+            char quote = 0;
+            for (; pos < xml.size(); ++pos)
+            {
+                if (quote != 0)
+                {
+                    if (xml[pos] == quote) quote = 0;
+                }
+                else if (xml[pos] == '"' || xml[pos] == '\'')
+                {
+                    quote = xml[pos];
+                }
+                else if (xml[pos] == '>')
+                {
+                    return pos + 1;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        // the raw (still entity encoded) value of an attribute of a start tag
+        static auto tag_attribute(std::string_view tag, std::string_view name) -> std::optional<std::string_view>
+        {
+            std::size_t pos = tag.find_first_of(" \t\n\r");
+            while (pos < tag.size())
+            {
+                auto eq = tag.find('=', pos);
+                if (eq == std::string_view::npos)
+                {
+                    break;
+                }
+                auto key = trim(tag.substr(pos, eq - pos));
+                auto open = tag.find_first_of("\"'", eq);
+                if (open == std::string_view::npos)
+                {
+                    break;
+                }
+                auto close = tag.find(tag[open], open + 1);
+                if (close == std::string_view::npos)
+                {
+                    break;
+                }
+                if (key == name)
+                {
+                    return tag.substr(open + 1, close - open - 1);
+                }
+                pos = close + 1;
+            }
+            return std::nullopt;
+        }
     }
 
     auto extract_encoded_drawio(const std::filesystem::path &path) -> tl::expected<std::string, ParseError>
@@ -119,7 +211,7 @@ namespace parser
         if (pRootElement != nullptr)
         {
             auto *pDiagram = pRootElement->FirstChildElement("diagram");
-            if (pDiagram != nullptr)
+            if (pDiagram != nullptr && pDiagram->GetText() != nullptr)
             {
                 return pDiagram->GetText();
             }
@@ -127,261 +219,236 @@ namespace parser
         return tl::unexpected<ParseError>(ParseError::ExtractingDrawioString);
     }
 
-    auto inflate(std::string_view str) -> tl::expected<std::string, ParseError>
+    auto map_drawio_file(const std::filesystem::path &path) -> tl::expected<MappedDrawio, ParseError>
     {
-        z_stream zs;
-        memset(&zs, 0, sizeof(zs));
+        if (path.empty())
+        {
+            return tl::unexpected<ParseError>(ParseError::EmptyPath);
+        }
 
-        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
-            return tl::unexpected<ParseError>(ParseError::InflationError);
+        auto file = utility::MappedFile::open(path);
+        if (!file)
+        {
+            return tl::unexpected<ParseError>(ParseError::InvalidEncodedDrawioFile);
+        }
 
-        zs.next_in = (Bytef *)str.data();
-        zs.avail_in = str.size();
+        MappedDrawio drawio{std::move(file.value()), {}, {}};
+        const auto xml = drawio.m_file.view();
 
-        int ret;
-        char outbuffer[32768];
-        std::string outstring;
+        auto mxfile = helpers::find_start_tag(xml, "mxfile", 0);
+        auto mxfile_end = helpers::find_tag_end(xml, mxfile);
+        if (mxfile == std::string_view::npos || mxfile_end == std::string_view::npos)
+        {
+            return tl::unexpected<ParseError>(ParseError::InvalidEncodedDrawioFile);
+        }
+        drawio.m_etag = helpers::tag_attribute(xml.substr(mxfile, mxfile_end - mxfile), "etag").value_or("");
 
-        do
+        // collect each page, stopping at the first which is not in the encoded format
+        auto pos = mxfile_end;
+        while ((pos = helpers::find_start_tag(xml, "diagram", pos)) != std::string_view::npos)
         {
-            zs.next_out = reinterpret_cast<Bytef *>(outbuffer);
-            zs.avail_out = sizeof(outbuffer);
-            ret = inflate(&zs, Z_NO_FLUSH);
-            if (outstring.size() < zs.total_out)
+            auto open_end = helpers::find_tag_end(xml, pos);
+            if (open_end == std::string_view::npos || xml[open_end - 2] == '/')
+            {
+                break;
+            }
+            auto close = xml.find("</diagram>", open_end);
+            auto payload = helpers::trim(xml.substr(open_end, close - open_end));
+            if (close == std::string_view::npos || payload.empty() || payload.find('<') != std::string_view::npos)
             {
-                outstring.append(outbuffer, zs.total_out - outstring.size());
+                break;
             }
+            drawio.m_diagrams.push_back(payload);
+            pos = close;
+        }
 
-        } while (ret == Z_OK);
+        if (drawio.m_diagrams.empty())
+        {
+            return tl::unexpected<ParseError>(ParseError::ExtractingDrawioString);
+        }
+        return drawio;
+    }
 
-        inflateEnd(&zs);
-        if (ret != Z_STREAM_END)
+    auto inflate(std::string_view str) -> tl::expected<std::string, ParseError>
+    {
+        std::string outstring;
+        if (!Inflater::local().inflate(str, outstring))
         {
             return tl::unexpected<ParseError>(ParseError::InflationError);
         }
-
         return outstring;
     }
 
     auto base64_decode(std::string_view encoded_str) -> tl::expected<std::string, ParseError>
     {
-        std::string out;
-        std::unordered_map<unsigned char, int> T;
-        for (int i = 0; i < 64; i++)
-            T["ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[i]] = i;
-
-        int val = 0, valb = -8;
-        for (unsigned char c : encoded_str)
+        std::string out(base64::decoded_capacity(encoded_str.size()), '\0');
+        auto n_decoded = base64::decode(encoded_str, reinterpret_cast<unsigned char *>(out.data()));
+        if (!n_decoded.has_value())
         {
-            if (!T.contains(c))
-                break;
-            val = (val << 6) + T[c];
-            valb += 6;
-            if (valb >= 0)
-            {
-                out.push_back(char((val >> valb) & 0xFF));
-                valb -= 8;
-            }
+            return tl::unexpected<ParseError>(ParseError::Base64DecodeError);
         }
+        out.resize(n_decoded.value());
         return out;
     }
 
     auto url_decode(std::string_view encoded_str) -> tl::expected<std::string, ParseError>
     {
-        CURL *curl = curl_easy_init();
-        int outlen;
-        if (curl)
+        std::string decoded{encoded_str};
+        auto result = percent::decode(decoded.data(), decoded.data() + decoded.size(), decoded.data());
+        decoded.resize(static_cast<std::size_t>(result.out - decoded.data()));
+        return decoded;
+    }
+
+    static auto to_state(const StyledCell &styled, SymbolTable &symbols, LabelBuffers &buffers) -> tl::expected<FSMState, ParseError>
+    {
+        const auto &cell = styled.m_cell;
+        /*
+        Valid expressions are
+            (1) $STATE=xyz;
+            (2) $OUTPUTS={a,b,c,d};
+            (3) {a,b,c,d}
+            (4) $DEFAULT};e
+            (5) __
+        Which are ; delimited, in any order
+        */
+        auto label = lexer::lex_state(helpers::sanitise(cell.m_value, buffers.m_value));
+        auto id = symbols.intern(helpers::sanitise(cell.m_id, buffers.m_id));
+
+        if (!label.m_outputs.has_value())
         {
-            char *decoded = curl_easy_unescape(curl, encoded_str.data(), encoded_str.length(), &outlen);
-            if (decoded)
+            if (!label.m_name.has_value())
+            {
+                return FSMState(id, label.m_is_default);
+            }
+            else
             {
-                std::string decoded_str(decoded, outlen);
-                curl_free(decoded);
-                curl_easy_cleanup(curl);
-                return decoded_str;
+                return FSMState(id, symbols.intern(label.m_name.value()), label.m_is_default);
             }
         }
-        return tl::unexpected<ParseError>(ParseError::URLDecodeError);
+
+        // get the outputs (i.e. OutputA,OutputB,...)
+        const auto list = label.m_outputs.value();
+        std::vector<Symbol> outputs;
+        outputs.reserve(static_cast<std::size_t>(ranges::count(list, ',')) + 1);
+        for (auto output : list | views::split(','))
+        {
+            outputs.push_back(symbols.intern(std::string_view(output.begin(), output.end())));
+        }
+
+        if (!label.m_name.has_value())
+        {
+            return FSMState(id, std::move(outputs), label.m_is_default);
+        }
+        else
+        {
+            return FSMState(id, symbols.intern(label.m_name.value()), std::move(outputs), label.m_is_default);
+        }
     }
 
-    static auto states_from_xml_elements(const std::vector<XMLElement *> &elements)
-        -> tl::expected<std::vector<FSMState>, ParseError>
+    static auto to_predicate(const StyledCell &styled, SymbolTable &symbols, LabelBuffers &buffers) -> tl::expected<FSMPredicate, ParseError>
     {
-        auto to_FSMState = [](XMLElement *el) -> tl::expected<FSMState, ParseError>
-        {
-            using namespace std::literals;
-            /*
-            Valid expressions are
-                (1) $STATE=xyz;
-                (2) $OUTPUTS={a,b,c,d};
-                (3) {a,b,c,d}
-                (4) $DEFAULT};e
-                (5) __
-            Which are ; delimited, in any order
-            */
-
-            // sanitise the input token of all font, size, and line breaks
-            std::string value{helpers::sanitise(el->Attribute("value"))};
-            auto toks = value 
-                | views::split(';') 
-                | views::transform([](auto r){ return std::string_view(r.begin(), r.end()); });
-
-            // get the state name token (if it exists)
-            std::string name;
-            auto state_match = [](std::string_view tok) { 
-                return std::regex_match(std::string(tok), std::regex("\\$STATE=[A-Za-z0-9_@./#&+-]+")); 
-            };
-            if (auto name_tok = ranges::find_if(toks, state_match); name_tok != toks.end())
-            {
-                std::string_view name_tok_v{*name_tok};
-                name_tok_v.remove_prefix(std::min(name_tok_v.find_first_of("=") + 1, name_tok_v.size()));
-                name = name_tok_v;
-            }
+        const auto &cell = styled.m_cell;
+        /*
+        Predicates are of the form:
+            (1) X                 // if X == 1 -> true path, else false path
+            (2) X <comparator> 1  // if X <comparator> 1 -> true path, else false path
+        where
+        <comparator> \in {==, !=, <, <=, >, >=}
+        */
+        auto label = lexer::lex_predicate(helpers::sanitise(cell.m_value, buffers.m_value));
+        if (!label)
+        {
+            return tl::unexpected<ParseError>(label.error());
+        }
 
-            // get the outputs string (i.e. OutputA,OutputB,...) (if it exists)
-            std::vector<std::string> outputs;
-            auto outputs_match = [](std::string_view tok) { 
-                return std::regex_match(std::string(tok), 
-                    std::regex("\\$OUTPUTS=\\{[A-Za-z0-9,_@./#&+-]+\\}|\\{[A-Za-z0-9,_@./#&+-]+\\}")); 
-            };
-            if (auto outputs_tok = ranges::find_if(toks, outputs_match); outputs_tok != toks.end())
-            {
-                std::string_view outputs_tok_v{*outputs_tok};
-                outputs_tok_v.remove_prefix(std::min(outputs_tok_v.find("{"sv) + 1, outputs_tok_v.size()));
-                outputs_tok_v.remove_suffix(std::max(outputs_tok_v.size() - outputs_tok_v.find_first_of("}"), std::size_t(0)));
-                outputs = outputs_tok_v 
-                    | views::split(',') 
-                    | views::transform([](auto r){ return std::string(r.begin(), r.end()); }) 
-                    | utility::to<std::vector<std::string>>();
-            }
+        auto id = symbols.intern(helpers::sanitise(cell.m_id, buffers.m_id));
+        if (label->m_comparator.has_value())
+        {
+            return FSMPredicate(
+                id,
+                symbols.intern(label->m_variable),
+                symbols.intern(label->m_comparator.value()),
+                symbols.intern(label->m_comparison_value.value())
+            );
+        }
+        return FSMPredicate(id, symbols.intern(label->m_variable));
+    }
 
-            bool is_default_state = ranges::find(toks, "$DEFAULT") != toks.end();
-            std::string id{helpers::sanitise(el->Attribute("id"))};
+    static auto to_arrow(const StyledCell &styled, SymbolTable &symbols, LabelBuffers &buffers) -> tl::expected<FSMArrow, ParseError>
+    {
+        const auto &cell = styled.m_cell;
+        if (!cell.m_source)
+        {
+            return tl::unexpected<ParseError>(ParseError::MissingSourceArrow);          
+        }
+            
+        if (!cell.m_target)
+        {
+            return tl::unexpected<ParseError>(ParseError::MissingTargetArrow);
+        }
+
+        FSMArrow arrow(
+            symbols.intern(helpers::sanitise(cell.m_id, buffers.m_id)),
+            symbols.intern(helpers::sanitise(cell.m_source, buffers.m_source)),
+            symbols.intern(helpers::sanitise(cell.m_target, buffers.m_target))
+        );
 
-            if (outputs.empty())
+        // if the arrow is relating toa decision block, it'll have a value
+        if (cell.m_value)
+        {
+            auto b = helpers::to_bool(helpers::sanitise(cell.m_value, buffers.m_value));
+            if (!b)
             {
-                if (name.empty())
-                {
-                    return FSMState(id, is_default_state);
-                }
-                else
-                {
-                    return FSMState(id, name, is_default_state);
-                }
+                return tl::unexpected<ParseError>(b.error());
             }
             else
             {
-                if (name.empty())
-                {
-                    return FSMState(id, outputs, is_default_state);
-                }
-                else
-                {
-                    return FSMState(id, name, outputs, is_default_state);
-                }
+                arrow.m_value = b.value();
             }
-        };
+        }
+        return arrow;
+    }
 
-        // construct the FSMStates and copy into output tokens
-        auto states = elements | views::filter(helpers::is_state) | views::transform(to_FSMState);
+    static auto states_from_cells(const std::vector<StyledCell> &cells, SymbolTable &symbols)
+        -> tl::expected<std::vector<FSMState>, ParseError>
+    {
+        // construct the FSMStates and move into output tokens
+        LabelBuffers buffers;
+        auto states = cells | views::filter(helpers::is_state) | views::transform([&symbols, &buffers](const StyledCell &cell){ return to_state(cell, symbols, buffers); });
 
         return utility::to_expected(states);
     }
 
-    static auto predicates_from_xml_elements(const std::vector<XMLElement *> &elements)
+    static auto predicates_from_cells(const std::vector<StyledCell> &cells, SymbolTable &symbols)
         -> tl::expected<std::vector<FSMPredicate>, ParseError>
     {
-
-        auto to_predicate = [](XMLElement *el) -> tl::expected<FSMPredicate, ParseError>
-        {
-            /*
-            Predicates are of the form:
-                (1) X                 // if X == 1 -> true path, else false path
-                (2) X <comparator> 1  // if X <comparator> 1 -> true path, else false path
-            where
-            <comparator> \in {==, !=, <, <=, >, >=}
-            */
-            std::string value = helpers::sanitise(el->Attribute("value"));
-            std::smatch pieces_match;
-            if (std::regex_match(value, pieces_match,
-                                 std::regex("[A-Za-z0-9_@./#&+-]+(==|!=|>|>=|<|<=)[A-Za-z0-9'_@./#&+-]+")))
-            {
-                // pieces match holds two things: <var><comparator><value>, <comparator>
-                // we want to split value on the second, i.e. <comparator>
-                std::string comparator{pieces_match[1].str()};
-                auto toks = value 
-                    | views::split(comparator) 
-                    | views::transform([](auto r){ return std::string_view(r.begin(), r.end()); }) 
-                    | utility::to<std::vector<std::string_view>>();
-
-                return FSMPredicate(
-                    helpers::sanitise(el->Attribute("id")),
-                    toks[0],
-                    comparator,
-                    toks[1]
-                );
-            }
-            else if (std::regex_match(value, std::regex("[A-Za-z0-9_@./#&+-]+")))
-            {
-                return FSMPredicate(
-                    helpers::sanitise(el->Attribute("id")),
-                    value
-                );
-            }
-            else
-            {
-                return tl::unexpected<ParseError>(ParseError::IncorrectPredicateFormat);
-            }
-        };
-
-        auto predicates = elements | views::filter(helpers::is_predicate) | views::transform(to_predicate);
+        LabelBuffers buffers;
+        auto predicates = cells | views::filter(helpers::is_predicate) | views::transform([&symbols, &buffers](const StyledCell &cell){ return to_predicate(cell, symbols, buffers); });
 
         return utility::to_expected(predicates);
     }
 
-    static auto arrows_from_xml_elements(const std::vector<XMLElement *> &elements)
+    static auto arrows_from_cells(const std::vector<StyledCell> &cells, SymbolTable &symbols)
         -> tl::expected<std::vector<FSMArrow>, ParseError>
     {
-        auto to_arrow = [](XMLElement *el) -> tl::expected<FSMArrow, ParseError>
-        {
-            auto pSource = el->Attribute("source");
-            if (!pSource)
-            {
-                return tl::unexpected<ParseError>(ParseError::MissingSourceArrow);          
-            }
-                
-            auto pTarget = el->Attribute("target");
-            if (!pTarget)
-            {
-                return tl::unexpected<ParseError>(ParseError::MissingTargetArrow);
-            }
+        LabelBuffers buffers;
+        auto arrows = cells | views::filter(helpers::is_arrow) | views::transform([&symbols, &buffers](const StyledCell &cell){ return to_arrow(cell, symbols, buffers); });
 
-            FSMArrow arrow(
-                helpers::sanitise(el->Attribute("id")),
-                helpers::sanitise(pSource),
-                helpers::sanitise(pTarget)
-            );
+        return utility::to_expected(arrows);
+    }
 
-            // if the arrow is relating toa decision block, it'll have a value
-            auto pValue = el->Attribute("value");
-            if (pValue)
+    // the attributes of a cell, viewing the strings held by the document
+    static auto to_cell(XMLElement *element) -> xml::Cell
+    {
+        auto attribute = [element](const char *name) -> std::optional<std::string_view>
+        {
+            if (auto value = element->Attribute(name); value != nullptr)
             {
-                auto b = helpers::to_bool(helpers::sanitise(pValue));
-                if (!b)
-                {
-                    return tl::unexpected<ParseError>(b.error());
-                }
-                else
-                {
-                    arrow.m_value = b.value();
-                }
+                return value;
             }
-            return arrow;
+            return std::nullopt;
         };
-
-        auto arrows = elements | views::filter(helpers::is_arrow) | views::transform(to_arrow);
-
-        return utility::to_expected(arrows);
+        return xml::Cell{attribute("id"), attribute("value"), attribute("style"), attribute("source"), attribute("target")};
     }
 
     auto drawio_to_tokens(std::string_view drawio_xml_str) -> tl::expected<TokenTuple, ParseError>
@@ -401,104 +468,166 @@ namespace parser
             {
                 // extract all the cells from the diagram
                 XMLElement *pCell = pRoot->FirstChildElement("mxCell");
-                std::vector<XMLElement *> elements;
+                std::vector<StyledCell> cells;
                 while (pCell)
                 {
                     if (pCell->Attribute("style"))
                     {
-                        elements.push_back(pCell);
+                        cells.push_back(helpers::with_style(to_cell(pCell)));
                     }
                     pCell = pCell->NextSiblingElement("mxCell");
                 }
 
-                auto states = states_from_xml_elements(elements);
+                SymbolTable symbols;
+                auto states = states_from_cells(cells, symbols);
                 if (!states)
                 {
                     return tl::unexpected<ParseError>(states.error());
                 }
-                auto predicates = predicates_from_xml_elements(elements);
+                auto predicates = predicates_from_cells(cells, symbols);
                 if (!predicates)
                 {
                     return tl::unexpected<ParseError>(predicates.error());
                 }
-                auto arrows = arrows_from_xml_elements(elements);
+                auto arrows = arrows_from_cells(cells, symbols);
                 if (!arrows)
                 {
                     return tl::unexpected<ParseError>(arrows.error());
                 }
 
-                return std::make_tuple(states.value(), predicates.value(), arrows.value());
+                return std::make_tuple(
+                    std::move(states.value()), 
+                    std::move(predicates.value()), 
+                    std::move(arrows.value()), 
+                    std::move(symbols)
+                );
             }
         }
         return tl::unexpected<ParseError>(ParseError::InvalidDecodedDrawioFile);
     }
 
-    // handle errors during parsing and token generation
-    void HandleParseError(const ParseError err)
+    auto stream_drawio_to_tokens(std::string_view drawio_xml_str) -> tl::expected<TokenTuple, ParseError>
     {
-        switch (err)
+        TokenTuple tokens;
+        auto &[states, predicates, arrows, symbols] = tokens;
+
+        // the first error of each kind, reported in the same order as drawio_to_tokens
+        std::optional<ParseError> state_error, predicate_error, arrow_error;
+        auto add = [](auto &tokens_of_kind, std::optional<ParseError> &error, auto &&token)
+        {
+            if (error.has_value())
+            {
+                return;
+            }
+            if (token)
+            {
+                tokens_of_kind.push_back(std::move(token.value()));
+            }
+            else
+            {
+                error = token.error();
+            }
+        };
+
+        // the cell, its style and its labels are rebuilt in place, reusing their storage
+        xml::CellReader reader(drawio_xml_str);
+        StyledCell c;
+        LabelBuffers buffers;
+        while (true)
+        {
+            auto cell = reader.next();
+            if (!cell)
+            {
+                return tl::unexpected<ParseError>(cell.error());
+            }
+            if (!cell->has_value())
+            {
+                break;
+            }
+
+            c.m_cell = cell->value();
+            style::parse(c.m_cell.m_style.value_or(""), c.m_style);
+            if (helpers::is_state(c))
+            {
+                add(states, state_error, to_state(c, symbols, buffers));
+            }
+            if (helpers::is_predicate(c))
+            {
+                add(predicates, predicate_error, to_predicate(c, symbols, buffers));
+            }
+            if (helpers::is_arrow(c))
+            {
+                add(arrows, arrow_error, to_arrow(c, symbols, buffers));
+            }
+        }
+
+        for (const auto &error : {state_error, predicate_error, arrow_error})
+        {
+            if (error.has_value())
+            {
+                return tl::unexpected<ParseError>(error.value());
+            }
+        }
+        return tokens;
+    }
+
+    static auto kind_message(const ParseError::Kind kind) -> std::string_view
+    {
+        switch (kind)
         {
         case ParseError::EmptyPath:
-            throw std::runtime_error(
-                "<EMPTY PATH> you provided an empty path to the draw.io diagram");
-            break;
+            return "<EMPTY PATH> you provided an empty path to the draw.io diagram";
         case ParseError::InvalidEncodedDrawioFile:
-            throw std::runtime_error(
-                "<INVALID ENCODED DRAWIO FILE ERROR> : you provided an invalid drawio file!");
-            break;
+            return "<INVALID ENCODED DRAWIO FILE ERROR> : you provided an invalid drawio file!";
         case ParseError::ExtractingDrawioString:
-            throw std::runtime_error(
-                "<EXTRACT STRING ERROR> : Could not extract encoded Draw.IO string"
-                "- are you sure you exported the XML in encoded format?");
-            break;
+            return "<EXTRACT STRING ERROR> : Could not extract encoded Draw.IO string"
+                   "- are you sure you exported the XML in encoded format?";
         case ParseError::URLDecodeError:
-            throw std::runtime_error(
-                "<URL DECODE ERROR> : Could not decode the Draw.IO diagram"
-                "- are you sure you exported the XML in encoded format?");
-            break;
+            return "<URL DECODE ERROR> : Could not decode the Draw.IO diagram"
+                   "- are you sure you exported the XML in encoded format?";
         case ParseError::Base64DecodeError:
-            throw std::runtime_error(
-                "<BASE64 DECODE ERROR> : Could not decode the Draw.IO diagram"
-                "- are you sure you exported the XML in encoded format?");
-            break;
+            return "<BASE64 DECODE ERROR> : Could not decode the Draw.IO diagram"
+                   "- are you sure you exported the XML in encoded format?";
         case ParseError::InflationError:
-            throw std::runtime_error(
-                "<INFLATION DECODE ERROR> : Could not decode the Draw.IO diagram"
-                "- are you sure you exported the XML in encoded format?");
-            break;
+            return "<INFLATION DECODE ERROR> : Could not decode the Draw.IO diagram"
+                   "- are you sure you exported the XML in encoded format?";
         case ParseError::DrawioToToken:
-            throw std::runtime_error(
-                "<DRAWIO TO TOKEN ERROR> : Could not transform the decoded Draw.IO file to a set of token"
-                "- are you sure that you have used *only* rhombus', rectangles, and arrow elements?");
-            break;
+            return "<DRAWIO TO TOKEN ERROR> : Could not transform the decoded Draw.IO file to a set of token"
+                   "- are you sure that you have used *only* rhombus', rectangles, and arrow elements?";
         case ParseError::DecisionPathError:
-            throw std::runtime_error(
-                "<DECISION PATH ERROR> : You have an unrouted decision block");
-            break;
+            return "<DECISION PATH ERROR> : You have an unrouted decision block";
         case ParseError::InvalidDecodedDrawioFile:
-            throw std::runtime_error(
-                "<INVALID DECODED DRAWIO FILE ERROR> : decoded Draw.IO");
-            break;
+            return "<INVALID DECODED DRAWIO FILE ERROR> : decoded Draw.IO";
         case ParseError::MissingSourceArrow:
-            throw std::runtime_error(
-                "<MISSING SOURCE ARROW> :  One of your arrows is not correctly connected to its source");
-            break;
+            return "<MISSING SOURCE ARROW> :  One of your arrows is not correctly connected to its source";
         case ParseError::MissingTargetArrow:
-            throw std::runtime_error(
-                "<MISSING TARGET ARROW> : One of your arrows is not correctly connected to its target");
-            break;
+            return "<MISSING TARGET ARROW> : One of your arrows is not correctly connected to its target";
         case ParseError::IncorrectPredicateFormat:
-            throw std::runtime_error(
-                "<INVALID PREDICATE FORMAT> : You provided an invalid predicate to one of the decision blocks");
-            break;
+            return "<INVALID PREDICATE FORMAT> : You provided an invalid predicate to one of the decision blocks";
         case ParseError::InvalidBooleanSpecifier:
-            throw std::runtime_error(
-                "<INVALID BOOLEAN SPECIFIER> : You provided an invalid boolean specified on a decision block arrow");
-            break;
+            return "<INVALID BOOLEAN SPECIFIER> : You provided an invalid boolean specified on a decision block arrow";
+        case ParseError::DecisionCycle:
+            return "<DECISION CYCLE ERROR> : These decision blocks form a loop which never reaches a state";
+        case ParseError::DecisionBudgetExceeded:
+            return "<DECISION BUDGET ERROR> : The decision blocks after this state expand to more nodes than allowed"
+                   " - raise --max-decision-nodes if the diagram really is this large";
         default:
-            throw std::runtime_error(
-                "Something unexpected went wrong ... try again.");
-            break;
+            return "Something unexpected went wrong ... try again.";
+        }
+    }
+
+    auto error_message(const ParseError& err) -> std::string
+    {
+        if (err.ids().empty())
+        {
+            return std::string(kind_message(err.kind()));
         }
+        return fmt::format("{} : {}", kind_message(err.kind()), fmt::join(err.ids(), ", "));
+    }
+
+    // handle errors during parsing and token generation
+    void HandleParseError(const ParseError& err)
+    {
+        throw std::runtime_error(error_message(err));
     }
-}
+}
\ No newline at end of file
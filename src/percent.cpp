@@ -0,0 +1,80 @@
+#include "../include/percent.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace parser::percent
+{
+    namespace helpers
+    {
+        static auto hex_value(char c) -> int
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        // the next '%' in [first, last), or last, checking 16 bytes at a time
+        static auto find_percent(const char *first, const char *last) -> const char *
+        {
+#if defined(__SSE2__)
+            const __m128i percent = _mm_set1_epi8('%');
+            for (; last - first >= 16; first += 16)
+            {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, percent));
+                if (mask != 0)
+                {
+                    return first + __builtin_ctz(static_cast<unsigned>(mask));
+                }
+            }
+#endif
+            auto found = static_cast<const char *>(std::memchr(first, '%', static_cast<std::size_t>(last - first)));
+            return found != nullptr ? found : last;
+        }
+    }
+
+    auto decode(const char *first, const char *last, char *out, bool final) -> DecodeResult
+    {
+        while (first < last)
+        {
+            // move the run up to the next escape in one go, nothing moves until the first escape
+            const char *percent = helpers::find_percent(first, last);
+            auto run = static_cast<std::size_t>(percent - first);
+            if (out != first)
+            {
+                std::memmove(out, first, run);
+            }
+            out += run;
+            first = percent;
+            if (first == last)
+            {
+                break;
+            }
+
+            if (last - first < 3)
+            {
+                if (!final)
+                {
+                    break;
+                }
+                *out++ = *first++;
+                continue;
+            }
+            int hi = helpers::hex_value(first[1]);
+            int lo = helpers::hex_value(first[2]);
+            if (hi < 0 || lo < 0)
+            {
+                *out++ = *first++;
+                continue;
+            }
+            *out++ = static_cast<char>((hi << 4) | lo);
+            first += 3;
+        }
+        return DecodeResult{out, first};
+    }
+}
@@ -0,0 +1,32 @@
+#include "../include/sink.hpp"
+
+namespace utility
+{
+    auto FileSink::write(std::string_view text) -> void
+    {
+        if (m_failed || text.empty())
+        {
+            return;
+        }
+        if (m_file == nullptr)
+        {
+            m_file = m_path.has_value() ? std::fopen(m_path->c_str(), "wb") : stdout;
+            m_failed = m_file == nullptr;
+        }
+        if (!m_failed && std::fwrite(text.data(), 1, text.size(), m_file) != text.size())
+        {
+            m_failed = true;
+        }
+    }
+
+    auto FileSink::close() -> bool
+    {
+        if (m_file != nullptr)
+        {
+            const bool closed = m_file == stdout ? std::fflush(m_file) == 0 : std::fclose(m_file) == 0;
+            m_failed = m_failed || !closed;
+            m_file = nullptr;
+        }
+        return !m_failed;
+    }
+}
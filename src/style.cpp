@@ -0,0 +1,48 @@
+#include "../include/style.hpp"
+
+#include <array>
+#include <utility>
+
+namespace parser::style
+{
+    namespace helpers
+    {
+        constexpr std::array<std::pair<std::string_view, Kind>, 2> shapes{{
+            {"text", Text}, {"rhombus", Rhombus}
+        }};
+    }
+
+    auto parse(std::string_view style) -> Style
+    {
+        Style result;
+        parse(style, result);
+        return result;
+    }
+
+    auto parse(std::string_view style, Style &result) -> void
+    {
+        result.m_kinds = 0;
+        while (!style.empty())
+        {
+            auto end = style.find(';');
+            auto token = style.substr(0, end);
+            style.remove_prefix(end == std::string_view::npos ? style.size() : end + 1);
+
+            auto eq = token.find('=');
+            if (eq == std::string_view::npos)
+            {
+                for (const auto &[name, kind] : helpers::shapes)
+                {
+                    if (token == name)
+                    {
+                        result.m_kinds |= kind;
+                    }
+                }
+            }
+            else if (token.substr(0, eq) == "edgeStyle" && token.substr(eq + 1) == "orthogonalEdgeStyle")
+            {
+                result.m_kinds |= OrthogonalEdge;
+            }
+        }
+    }
+}
@@ -0,0 +1,235 @@
+#include "../include/sv_template.hpp"
+#include "../include/mapped_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include <fmt/format.h>
+
+namespace fsm
+{
+    namespace helpers
+    {
+        constexpr std::array<std::pair<std::string_view, Template::Field>, 10> fields{{
+            {"inputs",           Template::Field::Inputs},
+            {"outputs",          Template::Field::Outputs},
+            {"state_decl",       Template::Field::StateDecl},
+            {"state_reg",        Template::Field::StateReg},
+            {"next_state",       Template::Field::NextState},
+            {"state_names",      Template::Field::StateNames},
+            {"reset_state",      Template::Field::ResetState},
+            {"default_state",    Template::Field::DefaultState},
+            {"outputs_defaults", Template::Field::OutputsDefaults},
+            {"cases",            Template::Field::Cases},
+        }};
+
+        static auto is_section(Template::Field field) -> bool
+        {
+            return field == Template::Field::StateDecl 
+                || field == Template::Field::StateReg 
+                || field == Template::Field::NextState;
+        }
+
+        static auto is_name_char(char c) -> bool
+        {
+            return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        }
+
+        static auto is_blank(char c) -> bool
+        {
+            return c == ' ' || c == '\t';
+        }
+
+        // the layout the builder wrote before it read templates, kept byte for byte
+        constexpr std::string_view module_template = 
+            "module fsm (\n"
+            "  input logic clk, reset,\n"
+            "  {inputs},\n"
+            "  {outputs}\n"
+            ");\n"
+            "\n"
+            "{state_decl}\n"
+            "\n"
+            "{state_reg}\n"
+            "\n"
+            "{next_state}\n"
+            "\n"
+            "endmodule";
+
+        constexpr std::string_view states_template = 
+            "typedef enum {\n"
+            "  {state_names}\n"
+            "} state_t;\n"
+            "\n"
+            "state_t present_state, next_state;";
+
+        constexpr std::string_view register_template = 
+            "always_ff @( posedge clk ) begin : sync\n"
+            "  if (reset)\n"
+            "    present_state <= {reset_state};\n"
+            "  else\n"
+            "    present_state <= next_state;\n"
+            "end";
+
+        constexpr std::string_view comb_template = 
+            "always_comb begin : comb\n"
+            "  {outputs_defaults}\n"
+            "  next_state = present_state;\n"
+            "  case (present_state)\n"
+            "    {cases}\n"
+            "    default : begin\n"
+            "      next_state = {default_state};\n"
+            "    end\n"
+            "  endcase\n"
+            "end";
+
+        // the whitespace the first indented line of a template starts with
+        static auto first_indentation(std::string_view text) -> std::string_view
+        {
+            for (std::size_t line = 0; line < text.size(); line = text.find('\n', line) + 1)
+            {
+                auto end = line;
+                while (end < text.size() && is_blank(text[end]))
+                {
+                    ++end;
+                }
+                if (end != line && end < text.size() && text[end] != '\n')
+                {
+                    return text.substr(line, end - line);
+                }
+                if (text.find('\n', line) == std::string_view::npos)
+                {
+                    break;
+                }
+            }
+            return Emitter::default_indentation;
+        }
+
+        // the module, states, register and comb templates in that order
+        constexpr std::array<std::string_view, 4> file_names{
+            "FSM_template.sv", "state_template.sv", "state_register_template.sv", "nest_state_template.sv"
+        };
+
+        static auto make_style(const std::array<std::string_view, 4>& texts) -> tl::expected<HouseStyle, std::string>
+        {
+            HouseStyle style;
+            const std::array<Template*, 4> templates{&style.m_module, &style.m_states, &style.m_register, &style.m_comb};
+            for (std::size_t i = 0; i < templates.size(); ++i)
+            {
+                auto parsed = Template::parse(texts[i], i == 0);
+                if (!parsed)
+                {
+                    return tl::unexpected<std::string>(fmt::format("{}: {}", file_names[i], parsed.error()));
+                }
+                *templates[i] = std::move(parsed.value());
+            }
+            style.m_indentation = std::string(first_indentation(texts[3]));
+            return style;
+        }
+    }
+
+    auto Template::parse(std::string_view text, bool is_module) -> tl::expected<Template, std::string>
+    {
+        Template parsed;
+        parsed.m_source = std::string(text);
+
+        std::size_t literal = 0;
+        std::size_t line = 0;
+        for (std::size_t pos = 0; pos < text.size(); ++pos)
+        {
+            if (text[pos] == '\n')
+            {
+                line = pos + 1;
+                continue;
+            }
+            if (text[pos] != '{')
+            {
+                continue;
+            }
+
+            auto end = pos + 1;
+            while (end < text.size() && helpers::is_name_char(text[end]))
+            {
+                ++end;
+            }
+            if (end == pos + 1 || end == text.size() || text[end] != '}')
+            {
+                continue;
+            }
+
+            const auto name = text.substr(pos + 1, end - pos - 1);
+            const auto *field = std::find_if(helpers::fields.begin(), helpers::fields.end(), [&](const auto& f)
+            {
+                return f.first == name;
+            });
+            if (field == helpers::fields.end())
+            {
+                return tl::unexpected<std::string>(fmt::format("{{{}}} is not a field", name));
+            }
+            if (!is_module && helpers::is_section(field->second))
+            {
+                return tl::unexpected<std::string>(fmt::format("{{{}}} can only be placed in the module template", name));
+            }
+
+            auto indentation = line;
+            while (indentation < pos && helpers::is_blank(text[indentation]))
+            {
+                ++indentation;
+            }
+            parsed.m_plan.push_back(Step{
+                Span{static_cast<std::uint32_t>(literal), static_cast<std::uint32_t>(pos - literal)},
+                field->second,
+                Span{static_cast<std::uint32_t>(line), static_cast<std::uint32_t>(indentation - line)}
+            });
+            literal = end + 1;
+            pos = end;
+        }
+        parsed.m_plan.push_back(Step{
+            Span{static_cast<std::uint32_t>(literal), static_cast<std::uint32_t>(text.size() - literal)},
+            std::nullopt,
+            Span{}
+        });
+        return parsed;
+    }
+
+    auto HouseStyle::defaults() -> const HouseStyle&
+    {
+        static const HouseStyle style = []
+        {
+            auto built_in = helpers::make_style({
+                helpers::module_template, 
+                helpers::states_template, 
+                helpers::register_template, 
+                helpers::comb_template
+            });
+            assert(built_in.has_value());
+            return std::move(built_in.value());
+        }();
+        return style;
+    }
+
+    auto HouseStyle::load(const std::filesystem::path& directory) -> tl::expected<HouseStyle, std::string>
+    {
+        std::array<utility::MappedFile, 4> files;
+        std::array<std::string_view, 4> texts;
+        for (std::size_t i = 0; i < files.size(); ++i)
+        {
+            const auto path = directory / helpers::file_names[i];
+            auto file = utility::MappedFile::open(path);
+            if (!file)
+            {
+                return tl::unexpected<std::string>(fmt::format("could not read {}: {}", path.string(), std::strerror(file.error())));
+            }
+            files[i] = std::move(file.value());
+            texts[i] = files[i].view();
+            if (texts[i].ends_with('\n'))
+            {
+                texts[i].remove_suffix(texts[i].ends_with("\r\n") ? 2 : 1);
+            }
+        }
+        return helpers::make_style(texts);
+    }
+}
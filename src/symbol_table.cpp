@@ -0,0 +1,73 @@
+#include "../include/symbol_table.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace utility
+{
+    namespace helpers
+    {
+        constexpr std::size_t block_size = 64 * 1024;
+    }
+
+    auto SymbolTable::intern(std::string_view str) -> Symbol
+    {
+        // keep the table at most half full
+        if (2 * (m_strings.size() + 1) > m_slots.size())
+        {
+            rehash(std::max<std::size_t>(64, 2 * m_slots.size()));
+        }
+
+        const auto hash = std::hash<std::string_view>{}(str);
+        const auto mask = m_slots.size() - 1;
+        for (auto slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            if (m_slots[slot].m_symbol == 0)
+            {
+                const auto symbol = static_cast<std::uint32_t>(m_strings.size());
+                m_strings.push_back(store(str));
+                m_hashes.push_back(hash);
+                m_slots[slot] = Slot{symbol + 1, static_cast<std::uint32_t>(hash)};
+                return static_cast<Symbol>(symbol);
+            }
+            const auto symbol = m_slots[slot].m_symbol - 1;
+            if (m_slots[slot].m_hash == static_cast<std::uint32_t>(hash) && m_strings[symbol] == str)
+            {
+                return static_cast<Symbol>(symbol);
+            }
+        }
+    }
+
+    // copies str into the current block, starting a new one when it does not fit
+    auto SymbolTable::store(std::string_view str) -> std::string_view
+    {
+        if (str.size() > m_block_free)
+        {
+            const auto size = std::max(helpers::block_size, str.size());
+            m_blocks.push_back(std::make_unique_for_overwrite<char[]>(size));
+            m_block_next = m_blocks.back().get();
+            m_block_free = size;
+        }
+        char *first = m_block_next;
+        std::memcpy(first, str.data(), str.size());
+        m_block_next += str.size();
+        m_block_free -= str.size();
+        return {first, str.size()};
+    }
+
+    auto SymbolTable::rehash(std::size_t n_slots) -> void
+    {
+        m_slots.assign(n_slots, Slot{0, 0});
+        const auto mask = n_slots - 1;
+        for (std::uint32_t symbol = 0; symbol < m_strings.size(); ++symbol)
+        {
+            auto slot = m_hashes[symbol] & mask;
+            while (m_slots[slot].m_symbol != 0)
+            {
+                slot = (slot + 1) & mask;
+            }
+            m_slots[slot] = Slot{symbol + 1, static_cast<std::uint32_t>(m_hashes[symbol])};
+        }
+    }
+}
@@ -2,6 +2,15 @@
 
 #include <cassert>
 #include <ranges>
+#include <utility>
+#include <tuple>
+#include <memory>
+#include <array>
+#include <limits>
+#include <span>
+#include <algorithm>
+
+#include "../include/thread_pool.hpp"
 
 #include <iostream>
 
@@ -10,9 +19,43 @@ namespace model
     namespace views  = std::views;
     namespace ranges = std::ranges;
 
+    namespace helpers
+    {
+        // the position of the element each id names: the first state with it, or failing
+        // that the first predicate, rank for neither. A diagram's symbols are numbered from
+        // 0 as they are interned, so the positions are a flat array indexed by id
+        static auto index_ids(
+            const States_t& states,
+            const Predicates_t& predicates
+        ) -> std::vector<unsigned>
+        {
+            const auto rank = static_cast<unsigned>(states.size() + predicates.size());
+            std::size_t n_symbols = 0;
+            for (const auto& state : states)
+            {
+                n_symbols = std::max<std::size_t>(n_symbols, static_cast<std::size_t>(state.m_id) + 1);
+            }
+            for (const auto& predicate : predicates)
+            {
+                n_symbols = std::max<std::size_t>(n_symbols, static_cast<std::size_t>(predicate.m_id) + 1);
+            }
+
+            std::vector<unsigned> positions(n_symbols, rank);
+            for (unsigned i = 0; i < rank; ++i)
+            {
+                const auto id = static_cast<std::size_t>(i < states.size() ? states[i].m_id : predicates[i - states.size()].m_id);
+                if (positions[id] == rank)
+                {
+                    positions[id] = i;
+                }
+            }
+            return positions;
+        }
+    }
+
     TransitionMatrix::TransitionMatrix() 
-        : m_connections{{}}, 
-          m_rank{0} 
+        : m_rank{0},
+          m_offsets{0}
     {}
 
     TransitionMatrix::TransitionMatrix (
@@ -20,12 +63,7 @@ namespace model
         const Arrows_t& arrows,
         const Predicates_t& predicates
     ) 
-        : m_rank{static_cast<unsigned>(states.size()+predicates.size())},
-          m_connections([&](){
-              auto sz = states.size()+predicates.size();
-              using matrix_t = decltype(m_connections);
-              return matrix_t(sz, matrix_t::value_type(sz, std::nullopt));
-          }())
+        : m_rank{static_cast<unsigned>(states.size()+predicates.size())}
     {
         populate_connection_matrix(states, arrows, predicates);
     }
@@ -36,55 +74,72 @@ namespace model
         const Predicates_t& predicates
     ) -> void
     {
-        auto find_pos = [&](std::string_view id)
+        // the position of the element with an id, rank if there is none
+        const auto positions = helpers::index_ids(states, predicates);
+        auto find_pos = [&](parser::Symbol id) -> unsigned
         {
-            auto get_id = [](auto& el){ return el.m_id; };
-
-            unsigned pos;
-            auto state_ids = states | views::transform(get_id);
-            auto res = ranges::find(state_ids, id);
-            if (res != state_ids.end())
-            {
-                pos = std::distance(state_ids.begin(), res);
-            }
-            else 
-            {
-                auto pred_ids = predicates | views::transform(get_id);
-                auto res = ranges::find(pred_ids, id);
-                pos = states.size() + std::distance(pred_ids.begin(), res);
-            }
-            return pos;
+            const auto i = static_cast<std::size_t>(id);
+            return i < positions.size() ? positions[i] : m_rank;
         };
 
+        struct SourcedEdge
+        {
+            unsigned m_source;
+            Edge m_edge;
+        };
+        std::vector<SourcedEdge> edges;
+        edges.reserve(arrows.size());
         for(const auto& arrow : arrows)
         {
             // deduce the row & column
             unsigned col = find_pos(arrow.m_source);
             unsigned row = find_pos(arrow.m_target);
 
-            // if its a decision node, the matrix value is the decision node value
-            if (arrow.m_value)
+            // arrows to or from anything other than a state or decision block go nowhere
+            if (row >= m_rank || col >= m_rank)
             {
-                this->set(row, col, arrow.m_value.value());
+                continue;
             }
+
+            // if its a decision node, the edge value is the decision node value
             // otherwise its a state->state transition, which is always true
-            else 
+            edges.push_back({col, {row, arrow.m_value.value_or(true)}});
+        }
+
+        // group by source then target, keeping arrow order so the last of any
+        // repeated source -> target arrows is the one which stays
+        ranges::stable_sort(edges, {}, [](const SourcedEdge& e) noexcept { return std::pair{e.m_source, e.m_edge.m_target}; });
+
+        m_offsets.assign(m_rank + 1, 0);
+        m_edges.clear();
+        m_edges.reserve(edges.size());
+        for (std::size_t i = 0; i < edges.size(); ++i)
+        {
+            if (i + 1 < edges.size() 
+                && edges[i + 1].m_source == edges[i].m_source 
+                && edges[i + 1].m_edge.m_target == edges[i].m_edge.m_target)
             {
-                this->set(row, col, true);
+                continue;
             }
-        }   
+            m_edges.push_back(edges[i].m_edge);
+            ++m_offsets[edges[i].m_source + 1];
+        }
+        for (unsigned col = 0; col < m_rank; ++col)
+        {
+            m_offsets[col + 1] += m_offsets[col];
+        }
     } 
 
-    auto TransitionMatrix::operator() (unsigned row, unsigned col) -> std::optional<bool>&
-    { 
-        assert(row < m_rank && col < m_rank); 
-        return m_connections[row][col];
-    }
-
     auto TransitionMatrix::operator() (unsigned row, unsigned col) const -> std::optional<bool>
     { 
         assert(row < m_rank && col < m_rank); 
-        return m_connections[row][col];
+        auto edges = successors(col);
+        auto edge = ranges::lower_bound(edges, row, {}, &Edge::m_target);
+        if (edge != edges.end() && edge->m_target == row)
+        {
+            return edge->m_value;
+        }
+        return std::nullopt;
     }
 
     auto TransitionMatrix::rank() -> unsigned
@@ -97,31 +152,43 @@ namespace model
         return m_rank;
     }
 
+    auto TransitionMatrix::successors(unsigned col) const -> std::span<const Edge>
+    {
+        assert(col < m_rank);
+        return std::span<const Edge>(m_edges).subspan(m_offsets[col], m_offsets[col + 1] - m_offsets[col]);
+    }
+
+    // inserting shifts every later edge, building from the arrows is the fast path
     auto TransitionMatrix::set(const unsigned row, const unsigned col, const bool value) -> void
     {
         assert(row < m_rank && col < m_rank); // 0 .. rank-1
-        m_connections[row][col] = value;
+        auto first = m_edges.begin() + m_offsets[col];
+        auto last = m_edges.begin() + m_offsets[col + 1];
+        auto edge = std::lower_bound(first, last, row, [](const Edge& e, unsigned target){ return e.m_target < target; });
+        if (edge != last && edge->m_target == row)
+        {
+            edge->m_value = value;
+            return;
+        }
+        m_edges.insert(edge, Edge{row, value});
+        for (auto i = col + 1; i < m_offsets.size(); ++i)
+        {
+            ++m_offsets[i];
+        }
     }
 
     auto TransitionMatrix::print() -> void
     {
-        for (const auto& row : m_connections)
-        {
-            for (const auto& elem : row)
-            {
-                if (elem.has_value()) fmt::print("{} ", elem.value());
-                else fmt::print("null");
-            }
-            fmt::print("\n");
-        }
+        std::as_const(*this).print();
     }
 
     auto TransitionMatrix::print() const -> void
     {
-        for (const auto& row : m_connections)
+        for (unsigned row = 0; row < m_rank; ++row)
         {
-            for (const auto& elem : row)
+            for (unsigned col = 0; col < m_rank; ++col)
             {
+                auto elem = (*this)(row, col);
                 if (elem.has_value()) fmt::print("{} ", elem.value());
                 else fmt::print("null");
             }
@@ -135,7 +202,7 @@ namespace model
             const std::vector<parser::FSMState>& states,
             const std::vector<parser::FSMPredicate>& predicates,
             const unsigned pos
-        ) -> std::string
+        ) -> parser::Symbol
         {
             if (pos < states.size()) 
             {
@@ -148,100 +215,319 @@ namespace model
             }
         };
 
-        static auto pred_from_id(
-            const std::vector<parser::FSMPredicate>& predicates,
-            const std::string_view id
-        ) -> std::optional<parser::FSMPredicate>
+        // the index into the predicates of a position, if it is one
+        static auto pred_from_position(
+            const std::vector<parser::FSMState>& states,
+            const unsigned pos
+        ) -> std::optional<std::uint32_t>
         {
-            auto predicate = predicates | std::views::filter([&id](auto& predicate){
-                return predicate.m_id == id;
-            }); 
-            if (predicate) 
+            if (pos < states.size()) 
             {
-                return predicate.front();
+                return std::nullopt;
             }
-            return std::nullopt;
+            return static_cast<std::uint32_t>(pos - states.size());
         };
 
-        static auto process_node(
-            // about the states
+        // the ids of the elements at a run of positions, for reporting errors
+        static auto ids_of(
             const std::vector<parser::FSMState>& states,
             const std::vector<parser::FSMPredicate>& predicates,
-            const TransitionMatrix& transition_matrix,
-            // where we are
-            const unsigned row, 
-            const unsigned col,
-            const std::unique_ptr<TransitionNode>& root
-        ) -> void
-        {        
-            auto add_node = [&](std::unique_ptr<TransitionNode>& node)
-            {
-                auto id = id_from_position(states, predicates, row);
-                auto pred = pred_from_id(predicates, id);
-                
-                // we are going to a decision block -> add the state and look at children
-                if (pred) 
+            const parser::SymbolTable& symbols,
+            std::span<const unsigned> positions
+        ) -> std::vector<std::string>
+        {
+            std::vector<std::string> ids;
+            for (auto pos : positions)
+            {
+                ids.emplace_back(symbols[id_from_position(states, predicates, pos)]);
+            }
+            return ids;
+        }
+
+        // expands the states and decision blocks of a diagram into one graph, adding each
+        // the first time it is reached so a block is expanded once however many states and
+        // blocks lead to it. Walked with an explicit stack, as chains of blocks can be long
+        class GraphExpander
+        {
+        public:
+            GraphExpander(
+                const States_t& states,
+                const Predicates_t& predicates,
+                const TransitionMatrix& transition_matrix,
+                const parser::SymbolTable& symbols
+            )
+                : m_states{states},
+                  m_predicates{predicates},
+                  m_transition_matrix{transition_matrix},
+                  m_symbols{symbols},
+                  m_sizes(transition_matrix.rank(), 1),
+                  m_nodes(transition_matrix.rank(), TransitionGraph::npos),
+                  m_on_path(transition_matrix.rank(), false)
+            {}
+
+            // the node of the element at pos, expanding it if it has not been reached yet
+            auto expand(const unsigned pos) -> tl::expected<TransitionGraph::index_type, parser::ParseError>
+            {
+                if (m_nodes[pos] == TransitionGraph::npos)
+                {
+                    visit(pos);
+                }
+                while (!m_path.empty())
+                {
+                    auto& step = m_path.back();
+                    if (step.m_side == 2)
+                    {
+                        // both sides are linked, so all that can be reached from here is known
+                        m_sizes[step.m_pos] = saturating_size(step);
+                        m_on_path[step.m_pos] = false;
+                        m_path.pop_back();
+                        continue;
+                    }
+
+                    auto child = step.m_side == 0 ? step.m_left : step.m_right;
+                    if (!child.has_value())
+                    {
+                        ++step.m_side;
+                        continue;
+                    }
+                    if (m_nodes[child.value()] == TransitionGraph::npos)
+                    {
+                        // linked once it has been expanded, when we are back at this step
+                        visit(child.value());
+                        continue;
+                    }
+                    if (m_on_path[child.value()])
+                    {
+                        return tl::unexpected<parser::ParseError>(cycle_error(child.value()));
+                    }
+
+                    auto& node = m_graph[m_nodes[step.m_pos]];
+                    (step.m_side == 0 ? node.m_left : node.m_right) = m_nodes[child.value()];
+                    ++step.m_side;
+                }
+                return m_nodes[pos];
+            }
+
+            auto graph() -> TransitionGraph&
+            {
+                return m_graph;
+            }
+
+            // the number of nodes in the tree below an expanded element once every path is
+            // written out, which is the work of emitting it. Saturates rather than overflowing
+            auto size(const unsigned pos) const -> std::uint64_t
+            {
+                return m_sizes[pos];
+            }
+
+        private:
+            // a decision block on the path being expanded, and which of its sides is next
+            struct Step
+            {
+                unsigned m_pos;
+                std::optional<unsigned> m_left;
+                std::optional<unsigned> m_right;
+                unsigned m_side = 0;
+            };
+
+            // adds the node of the element at pos, and if it is a decision block puts it on
+            // the path so its children are expanded next
+            auto visit(const unsigned pos) -> void
+            {
+                // we are going to a decision block -> add the state and look at children,
+                // otherwise we are going to a state -> add the state and terminate
+                auto pred = pred_from_position(m_states, pos);
+                m_nodes[pos] = pred.has_value()
+                    ? m_graph.insert(parser::FSMTransition(m_predicates[pred.value()].m_id, pred.value()))
+                    : m_graph.insert(parser::FSMTransition(id_from_position(m_states, m_predicates, pos)));
+
+                if (pred.has_value())
                 {
-                    parser::FSMTransition transition(pred.value());
-                    node = std::make_unique<TransitionNode>(transition);
-                    // process each of the possible children nodes
-                    for (unsigned i = 0; i < transition_matrix.rank(); ++i)
+                    // of several edges with the same value, the last one is taken
+                    Step step{pos, std::nullopt, std::nullopt};
+                    for (const auto& next : m_transition_matrix.successors(pos))
                     {
-                        process_node(
-                            states, predicates, transition_matrix, 
-                            i, row, node
-                        );
+                        (next.m_value ? step.m_left : step.m_right) = next.m_target;
                     }
+                    m_on_path[pos] = true;
+                    m_path.push_back(step);
                 }
-                // we are going to a state -> add the state and terminate
-                else 
+            }
+
+            auto saturating_size(const Step& step) const -> std::uint64_t
+            {
+                constexpr auto max = std::numeric_limits<std::uint64_t>::max() / 4;
+                std::uint64_t size = 1;
+                for (auto child : {step.m_left, step.m_right})
                 {
-                    parser::FSMTransition transition(id);
-                    node = std::make_unique<TransitionNode>(transition);
+                    if (child.has_value())
+                    {
+                        size += m_sizes[child.value()];
+                    }
                 }
-            };
+                return std::min(size, max);
+            }
 
-            if (transition_matrix(row,col).has_value())
+            // the blocks on the path from where pos was first reached back round to it
+            auto cycle_error(const unsigned pos) const -> parser::ParseError
             {
-                if (transition_matrix(row,col).value()) 
+                auto first = ranges::find(m_path, pos, &Step::m_pos);
+                std::vector<unsigned> cycle;
+                for (auto step = first; step != m_path.end(); ++step)
                 {
-                    add_node(root->m_left);
+                    cycle.push_back(step->m_pos);
+                }
+                return parser::ParseError(parser::ParseError::DecisionCycle, ids_of(m_states, m_predicates, m_symbols, cycle));
+            }
+
+            const States_t& m_states;
+            const Predicates_t& m_predicates;
+            const TransitionMatrix& m_transition_matrix;
+            const parser::SymbolTable& m_symbols;
+
+            TransitionGraph m_graph;
+            std::vector<std::uint64_t> m_sizes;               // by position
+            std::vector<TransitionGraph::index_type> m_nodes; // by position, npos until reached
+            std::vector<bool> m_on_path;                      // by position
+            std::vector<Step> m_path;
+        };
+
+        // a transition out of a state as (target, source, value), ordered as they are listed
+        using Transition = std::tuple<unsigned, unsigned, bool>;
+
+        // the trees of a run of transitions, sharing their decision blocks in one graph
+        struct TreeChunk
+        {
+            std::shared_ptr<const TransitionGraph> m_graph;
+            std::vector<TransitionGraph::index_type> m_roots;
+            std::vector<std::uint64_t> m_sizes;        // of each tree once written out
+            std::optional<parser::ParseError> m_error; // at the transition after the last root
+        };
+
+        // expands the trees of the transitions in turn, stopping at the first loop or once
+        // they alone are over the node budget
+        static auto build_chunk(
+            const States_t& states,
+            const Predicates_t& predicates,
+            const TransitionMatrix& transition_matrix,
+            const parser::SymbolTable& symbols,
+            const std::uint64_t node_budget,
+            std::span<const Transition> transitions
+        ) -> TreeChunk
+        {
+            TreeChunk chunk;
+            GraphExpander expander(states, predicates, transition_matrix, symbols);
+            auto& graph = expander.graph();
+            std::uint64_t n_nodes = 0;
+            for (const auto& [row, col, value] : transitions)
+            {
+                auto target = expander.expand(row);
+                if (!target)
+                {
+                    chunk.m_error = target.error();
+                    break;
+                }
+
+                auto root = graph.insert(parser::FSMTransition(id_from_position(states, predicates, col)));
+                if (value) 
+                {
+                    graph[root].m_left = target.value();
                 }
                 else
                 {
-                    add_node(root->m_right);
+                    graph[root].m_right = target.value();
+                }
+                chunk.m_roots.push_back(root);
+                chunk.m_sizes.push_back(1 + expander.size(row));
+
+                n_nodes += chunk.m_sizes.back();
+                if (n_nodes > node_budget)
+                {
+                    break;
                 }
             }
+            chunk.m_graph = std::make_shared<const TransitionGraph>(std::move(graph));
+            return chunk;
         }
     }
     
     auto build_transition_tree_map(
         const States_t& states,
         const Predicates_t& predicates,
-        const TransitionMatrix& transition_matrix
-    ) -> StateTransitionMap
+        const TransitionMatrix& transition_matrix,
+        const parser::SymbolTable& symbols,
+        const std::uint64_t node_budget,
+        const unsigned n_workers
+    ) -> tl::expected<StateTransitionMap, parser::ParseError>
     {
-        // visit each position in the transition matrix corresponding to a state
-        // for each, follow the path, until all branches lead to another state
-        // proceed with the next position
+        // visit each transition out of a state, ordered by target then source as they
+        // have always been listed. For each, follow the path, until all branches lead to
+        // another state, then proceed with the next transition
+        std::vector<helpers::Transition> transitions;
+        for (unsigned col = 0; col < states.size(); ++col)
+        {
+            for (const auto& edge : transition_matrix.successors(col))
+            {
+                transitions.emplace_back(edge.m_target, col, edge.m_value);
+            }
+        }
+        ranges::sort(transitions);
+
+        // the trees only read the diagram, so runs of them can be expanded at once. Each run
+        // shares blocks within itself, a block reached from several runs is expanded in each
+        constexpr std::size_t min_chunk_size = 1024;
+        const auto n_chunks = std::clamp<std::size_t>(transitions.size() / min_chunk_size, 1, 4 * std::max(n_workers, 1u));
+        std::vector<helpers::TreeChunk> chunks(n_workers > 1 ? n_chunks : 1);
+        auto chunk_transitions = [&](std::size_t i)
+        {
+            const auto first = transitions.size() * i / chunks.size();
+            const auto last = transitions.size() * (i + 1) / chunks.size();
+            return std::span<const helpers::Transition>(transitions).subspan(first, last - first);
+        };
+        if (chunks.size() == 1)
+        {
+            chunks.front() = helpers::build_chunk(states, predicates, transition_matrix, symbols, node_budget, transitions);
+        }
+        else
+        {
+            utility::ThreadPool pool{std::min<unsigned>(n_workers, static_cast<unsigned>(chunks.size()))};
+            for (std::size_t i = 0; i < chunks.size(); ++i)
+            {
+                pool.submit([&, i]
+                {
+                    chunks[i] = helpers::build_chunk(states, predicates, transition_matrix, symbols, node_budget, chunk_transitions(i));
+                });
+            }
+            pool.wait();
+        }
+
+        // merge the runs in order, failing at the first transition the serial walk would
         StateTransitionMap state_tree_map;
-        for (unsigned row = 0; row < transition_matrix.rank(); ++row)
-        {
-            for (unsigned col = 0; col < states.size(); ++col)
-            {           
-                if (transition_matrix(row,col).has_value()) //we got a transition
-                {                    
-                    std::string id = helpers::id_from_position(states, predicates, col);
-                    parser::FSMTransition root(id);
-
-                    auto root_ptr = std::make_unique<TransitionNode>(root);
-                    helpers::process_node(
-                        states, predicates, transition_matrix, 
-                        row, col, root_ptr
-                    );
-
-                    state_tree_map.push_back({states[col], TransitionTree(std::move(root_ptr))});
+        state_tree_map.reserve(transitions.size());
+        std::uint64_t n_nodes = 0;
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+        {
+            const auto& chunk = chunks[i];
+            const auto run = chunk_transitions(i);
+            for (std::size_t j = 0; j < chunk.m_roots.size(); ++j)
+            {
+                const auto [row, col, value] = run[j];
+
+                // stop before emitting more than the budget allows
+                if (chunk.m_sizes[j] > node_budget - n_nodes)
+                {
+                    const std::array<unsigned, 2> ends{col, row};
+                    return tl::unexpected<parser::ParseError>(parser::ParseError(
+                        parser::ParseError::DecisionBudgetExceeded, helpers::ids_of(states, predicates, symbols, ends)
+                    ));
                 }
+                n_nodes += chunk.m_sizes[j];
+
+                state_tree_map.push_back({states[col], TransitionTree{chunk.m_graph, chunk.m_roots[j]}});
+            }
+            if (chunk.m_error.has_value())
+            {
+                return tl::unexpected<parser::ParseError>(chunk.m_error.value());
             }
         }
         return state_tree_map;
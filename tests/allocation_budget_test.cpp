@@ -0,0 +1,83 @@
+#include "../include/app.hpp"
+#include "../include/sink.hpp"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// counts every allocation made through the global operator new, so the conversion of a fixed
+// diagram can be held to a budget and a change which brings back per-node allocations fails here
+namespace
+{
+    std::atomic<std::size_t> allocations{0};
+}
+
+auto operator new(std::size_t size) -> void*
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto *memory = std::malloc(size != 0 ? size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+auto operator new[](std::size_t size) -> void*
+{
+    return operator new(size);
+}
+auto operator delete(void *memory) noexcept -> void
+{
+    std::free(memory);
+}
+auto operator delete(void *memory, std::size_t) noexcept -> void
+{
+    std::free(memory);
+}
+auto operator delete[](void *memory) noexcept -> void
+{
+    std::free(memory);
+}
+auto operator delete[](void *memory, std::size_t) noexcept -> void
+{
+    std::free(memory);
+}
+
+namespace helpers
+{
+    // the allocations made by one streamed conversion of the diagram
+    static auto count_conversion(const std::filesystem::path &diagram, const app::Options &options) -> std::size_t
+    {
+        utility::StringSink sink;
+        const auto before = allocations.load(std::memory_order_relaxed);
+        auto converted = app::convert(diagram, options, sink);
+        const auto after = allocations.load(std::memory_order_relaxed);
+        if (!converted)
+        {
+            fmt::print(stderr, "{}: {}\n", diagram.string(), parser::error_message(converted.error()));
+            std::exit(1);
+        }
+        return after - before;
+    }
+}
+
+// usage: allocation_budget_test <diagram> <budget>
+auto main(int argc, char **argv) -> int
+{
+    if (argc != 3)
+    {
+        fmt::print(stderr, "usage: {} <diagram> <allocation budget>\n", argv[0]);
+        return 2;
+    }
+    const std::filesystem::path diagram{argv[1]};
+    const auto budget = std::strtoull(argv[2], nullptr, 10);
+
+    // the first conversion pays for one off set up such as the locale, so only the second is counted
+    const app::Options options;
+    static_cast<void>(helpers::count_conversion(diagram, options));
+    const auto counted = helpers::count_conversion(diagram, options);
+
+    fmt::print("{}: {} allocations, budget {}\n", diagram.filename().string(), counted, budget);
+    return counted <= budget ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include "../include/base64.hpp"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// checks every kernel the cpu supports against a plain reference decoder, over random lengths
+// so each vector loop hands a different tail to the scalar loop, and with invalid bytes placed
+// in the part the vector loops decode as well as in the tail
+namespace helpers
+{
+    constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // bytes just either side of the alphabet's ranges, which the nibble lookups have to tell apart
+    constexpr std::string_view invalid = std::string_view{"=-_ .,:;@[`{~\n\r\t\0\x7f\x80\xaa\xff", 22};
+
+    using Decoded = std::optional<std::vector<unsigned char>>;
+
+    static auto encode(const std::vector<unsigned char> &bytes) -> std::string
+    {
+        std::string out;
+        std::size_t i = 0;
+        for (; i + 3 <= bytes.size(); i += 3)
+        {
+            const std::uint32_t group = (std::uint32_t{bytes[i]} << 16) | (std::uint32_t{bytes[i + 1]} << 8) | bytes[i + 2];
+            for (int shift = 18; shift >= 0; shift -= 6)
+            {
+                out += alphabet[(group >> shift) & 0x3F];
+            }
+        }
+        if (const auto rest = bytes.size() - i; rest != 0)
+        {
+            const std::uint32_t group = (std::uint32_t{bytes[i]} << 16) | (rest == 2 ? std::uint32_t{bytes[i + 1]} << 8 : 0);
+            out += alphabet[(group >> 18) & 0x3F];
+            out += alphabet[(group >> 12) & 0x3F];
+            out += rest == 2 ? alphabet[(group >> 6) & 0x3F] : '=';
+            out += '=';
+        }
+        return out;
+    }
+
+    // one character at a time, following the same rules as decode() on padding
+    static auto reference(std::string_view in, bool allow_padding) -> Decoded
+    {
+        if (allow_padding && in.size() % 4 == 0)
+        {
+            for (int pad = 0; pad < 2 && !in.empty() && in.back() == '='; ++pad)
+            {
+                in.remove_suffix(1);
+            }
+        }
+        if (in.size() % 4 == 1)
+        {
+            return std::nullopt;
+        }
+        std::vector<unsigned char> out;
+        std::uint32_t bits = 0;
+        int held = 0;
+        for (char c : in)
+        {
+            const auto sextet = alphabet.find(c);
+            if (sextet == std::string_view::npos)
+            {
+                return std::nullopt;
+            }
+            bits = (bits << 6) | static_cast<std::uint32_t>(sextet);
+            held += 6;
+            if (held >= 8)
+            {
+                held -= 8;
+                out.push_back(static_cast<unsigned char>(bits >> held));
+            }
+        }
+        return out;
+    }
+
+    static auto decode(std::string_view in, bool allow_padding, parser::base64::Kernel kernel) -> Decoded
+    {
+        std::vector<unsigned char> out(parser::base64::decoded_capacity(in.size()));
+        auto decoded = parser::base64::decode(in, out.data(), allow_padding, kernel);
+        if (!decoded)
+        {
+            return std::nullopt;
+        }
+        out.resize(decoded.value());
+        return out;
+    }
+}
+
+auto main() -> int
+{
+    using parser::base64::Kernel;
+    constexpr std::array kernels{std::pair{Kernel::avx2, "avx2"}, std::pair{Kernel::sse41, "sse4.1"}, std::pair{Kernel::scalar, "scalar"}};
+
+    std::mt19937 random{20240611};
+    auto pick = [&](std::size_t n) { return std::uniform_int_distribution<std::size_t>{0, n - 1}(random); };
+
+    unsigned failures = 0;
+    unsigned cases = 0;
+    auto check = [&](const std::string &in, bool allow_padding)
+    {
+        ++cases;
+        const auto expected = helpers::reference(in, allow_padding);
+        for (const auto &[kernel, name] : kernels)
+        {
+            if (parser::base64::supported(kernel) && helpers::decode(in, allow_padding, kernel) != expected && failures++ < 10)
+            {
+                fmt::print(stderr, "{}: differs from the reference on {} characters (padding {})\n", name, in.size(), allow_padding);
+            }
+        }
+    };
+
+    for (std::size_t n = 0; n < 2000; ++n)
+    {
+        // short lengths one by one, then a spread of longer ones
+        std::vector<unsigned char> bytes(n < 400 ? n : 400 + pick(8000));
+        for (auto &byte : bytes)
+        {
+            byte = static_cast<unsigned char>(pick(256));
+        }
+        auto encoded = helpers::encode(bytes);
+        check(encoded, true);
+        check(encoded, false);
+
+        auto unpadded = encoded.substr(0, encoded.find('='));
+        check(unpadded, true);
+        check(unpadded, false);
+
+        if (!unpadded.empty())
+        {
+            // one bad byte anywhere, including right at the front and in the last group
+            auto corrupt = unpadded;
+            corrupt[pick(corrupt.size())] = helpers::invalid[pick(helpers::invalid.size())];
+            check(corrupt, true);
+            corrupt = unpadded;
+            corrupt[corrupt.size() - 1 - pick(std::min<std::size_t>(corrupt.size(), 4))] = helpers::invalid[pick(helpers::invalid.size())];
+            check(corrupt, true);
+        }
+    }
+
+    // every byte value in the vector part and in the tail of a fixed input
+    const auto base = helpers::encode(std::vector<unsigned char>(96, 0x5A));
+    for (std::size_t at : {std::size_t{0}, std::size_t{31}, std::size_t{47}, base.size() - 1})
+    {
+        for (unsigned value = 0; value < 256; ++value)
+        {
+            auto in = base;
+            in[at] = static_cast<char>(value);
+            check(in, true);
+        }
+    }
+
+    for (const auto &[kernel, name] : kernels)
+    {
+        fmt::print("{}: {}\n", name, parser::base64::supported(kernel) ? "checked" : "not supported by this cpu");
+    }
+    fmt::print("{} inputs, {} mismatches\n", cases, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include "../include/parser.hpp"
+#include "../include/decoder.hpp"
+#include "../include/transition_matrix.hpp"
+#include "../include/FSM_builder.hpp"
+
+#include <fmt/format.h>
+
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+
+// changes entries of the state transition map through the builder and checks that the next
+// write only writes the arms of the entries which changed, and gives the same module as a
+// builder starting from scratch on the changed map
+namespace helpers
+{
+    static auto fail(std::string_view message) -> void
+    {
+        fmt::print(stderr, "{}\n", message);
+        std::exit(EXIT_FAILURE);
+    }
+
+    static auto fresh_build(const StateTransitionMap &map, const Predicates_t &predicates, const parser::SymbolTable &symbols) -> std::string
+    {
+        auto copy = map;
+        return fsm::FSMBuilder(copy, predicates, symbols).write();
+    }
+}
+
+// usage: incremental_build_test <diagram>
+auto main(int argc, char **argv) -> int
+{
+    if (argc != 2)
+    {
+        fmt::print(stderr, "usage: {} <diagram>\n", argv[0]);
+        return 2;
+    }
+
+    auto drawio = parser::map_drawio_file(argv[1]);
+    if (!drawio || drawio->m_diagrams.empty())
+    {
+        helpers::fail("could not read the diagram");
+    }
+    auto decoded = parser::decode_diagram(drawio->m_diagrams.front());
+    auto tokens = decoded ? parser::stream_drawio_to_tokens(decoded.value()) : tl::unexpected(decoded.error());
+    if (!tokens)
+    {
+        helpers::fail(parser::error_message(tokens.error()));
+    }
+    auto &[states, predicates, arrows, symbols] = tokens.value();
+    const model::TransitionMatrix matrix(states, arrows, predicates);
+    auto map = model::build_transition_tree_map(states, predicates, matrix, symbols);
+    if (!map || map->size() < 3)
+    {
+        helpers::fail("expected a diagram with at least three states");
+    }
+
+    fsm::FSMBuilder builder(map.value(), predicates, symbols);
+    auto &entries = builder.state_transition_map();
+    const auto n = entries.size();
+
+    // without an expected number of arms, any may be written but not all of them
+    auto check = [&](std::string_view change, std::optional<std::size_t> expected_arms)
+    {
+        const auto written = builder.write();
+        if (expected_arms.has_value() ? builder.arms_written() != expected_arms.value() : builder.arms_written() == n)
+        {
+            helpers::fail(fmt::format("{}: wrote {} of {} arms", change, builder.arms_written(), n));
+        }
+        if (written != helpers::fresh_build(entries.value(), predicates, symbols))
+        {
+            helpers::fail(fmt::format("{}: differs from a fresh build", change));
+        }
+        fmt::print("{}: {} of {} arms written\n", change, builder.arms_written(), n);
+    };
+
+    check("first build", n);
+    check("unchanged", 0);
+
+    // one entry takes the transition tree of another
+    {
+        auto entry = entries[1];
+        entry.second = entries[2].second;
+        entries.write(1, std::move(entry));
+    }
+    check("one transition tree changed", 1);
+
+    // one state gains an output, which only its own arm sets
+    {
+        auto entry = entries[0];
+        if (!entry.first.m_outputs.has_value())
+        {
+            entry.first.m_outputs.emplace();
+        }
+        entry.first.m_outputs->push_back(symbols.intern("INCREMENTAL_TEST_OUT"));
+        entries.write(0, std::move(entry));
+    }
+    check("one state's outputs changed", 1);
+
+    // written back as it was, which is still a change of version
+    entries.write(2, entries[2]);
+    check("one entry rewritten unchanged", 1);
+
+    // a state renamed, so the kept arms naming it have to be written again too
+    {
+        auto entry = entries[3 % n];
+        entry.first.m_state_name = symbols.intern("INCREMENTAL_TEST_STATE");
+        entries.write(3 % n, std::move(entry));
+    }
+    check("one state renamed", std::nullopt);
+
+    return EXIT_SUCCESS;
+}